@@ -0,0 +1,41 @@
+# Fails when the firmware's own code (main.cpp, game/, drivers/) calls a
+# heap allocator.
+# Usage: cmake -DNM=<nm> -DOBJECTS=<object;...> -DONLY=<regex> -P check_no_heap.cmake
+#
+# Only the objects whose path matches ONLY are read: the SDK's sources are
+# built into the same target, and its stdio and printf may allocate on
+# their own. An undefined reference is enough to fail, whether or not
+# --gc-sections drops the caller later.
+
+set(checked 0)
+set(found "")
+foreach(object IN LISTS OBJECTS)
+    if(NOT object MATCHES "${ONLY}")
+        continue()
+    endif()
+    math(EXPR checked "${checked} + 1")
+    execute_process(COMMAND ${NM} --undefined-only ${object}
+            OUTPUT_VARIABLE symbols
+            RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${NM} failed on ${object}")
+    endif()
+    # malloc family (plain and reentrant) and operator new / new[] in all
+    # their overloads
+    string(REGEX MATCHALL "[\n ]_?(malloc|calloc|realloc|memalign)(_r)?\n|[\n ]_Zn[wa][jm][A-Za-z0-9_]*\n"
+            hits "\n${symbols}\n")
+    foreach(hit IN LISTS hits)
+        string(REGEX REPLACE "[\n ]" "" hit "${hit}")
+        get_filename_component(name ${object} NAME)
+        list(APPEND found "${name}: ${hit}")
+    endforeach()
+endforeach()
+
+if(checked EQUAL 0)
+    message(FATAL_ERROR "no objects matched ${ONLY}")
+endif()
+if(found)
+    list(REMOVE_DUPLICATES found)
+    list(JOIN found ", " found)
+    message(FATAL_ERROR "firmware code calls a heap allocator: ${found}")
+endif()
@@ -1,4 +1,6 @@
+#include <string.h>
 #include "st7735.h"
+#include "st7735_port.h"
 
 // based on Adafruit ST7735 library for Arduino
 static const uint8_t init_cmds1[] = { // Init for 7735R, part 1 (red or green tab)
@@ -61,14 +63,101 @@ static const uint8_t init_cmds1[] = { // Init for 7735R, part 1 (red or green ta
 #define FB_WIDTH  ST7735_WIDTH
 #define FB_HEIGHT ST7735_HEIGHT
 
-// framebuffer: store 16-bit color (RGB565) per pixel
-static uint16_t framebuffer[FB_WIDTH * FB_HEIGHT];
+// framebuffer: 16-bit color (RGB565) per pixel, or an 8-bit palette index
+#if ST7735_FB_INDEXED
+typedef uint8_t fb_pixel_t;
+#else
+typedef uint16_t fb_pixel_t;
+#endif
+
+#if ST7735_BAND_ROWS
+// band mode: only physical rows fb_band_y0..fb_band_y1 are held; draw calls
+// are clipped to them and replayed once per band
+static fb_pixel_t framebuffers[2][FB_WIDTH * ST7735_BAND_ROWS];
+static int16_t fb_band_y0 = 0, fb_band_y1 = ST7735_BAND_ROWS - 1;
+#else
+#if ST7735_DOUBLE_BUFFER
+static fb_pixel_t framebuffers[2][FB_WIDTH * FB_HEIGHT];
+#else
+static fb_pixel_t framebuffers[1][FB_WIDTH * FB_HEIGHT];
+#endif
+static const int16_t fb_band_y0 = 0, fb_band_y1 = FB_HEIGHT - 1;
+#endif
+// buffer the draw calls write into; with double buffering the other one may be on the wire
+static fb_pixel_t *framebuffer = framebuffers[0];
+static volatile bool present_busy = false;
+
+// dirty tracking: one bit per 8x8 tile of the physical framebuffer, set by every write
+#define FB_TILE_SHIFT 3
+#define FB_TILE       (1 << FB_TILE_SHIFT)
+#define FB_TILE_COLS  (FB_WIDTH >> FB_TILE_SHIFT)
+#define FB_TILE_ROWS  (FB_HEIGHT >> FB_TILE_SHIFT)
+static_assert(FB_TILE_COLS <= 16, "a tile row must fit the uint16_t dirty mask");
+
+static uint16_t fb_dirty[FB_TILE_ROWS];
+
+// buffer whose content is on the panel (NULL: unknown, send everything)
+static const fb_pixel_t *panel_frame = NULL;
+
+// one address window + RAMWR burst per region, physical pixels, inclusive
+typedef struct
+{
+    uint8_t x0, y0, x1, y1;
+} fb_region_t;
+
+// framebuffer words touched several pixels at a time
+typedef uint32_t __attribute__((may_alias)) fb_word_t;
+#define FB_PER_WORD (sizeof(fb_word_t) / sizeof(fb_pixel_t))
+
+#if ST7735_BAND_ROWS
+static fb_region_t present_regions[1];
+#else
+static fb_region_t present_regions[FB_TILE_ROWS * (FB_TILE_COLS / 2)];
+#endif
+// present_count never exceeds it; bounds the walk for the compiler too
+#define PRESENT_MAX (sizeof(present_regions) / sizeof(present_regions[0]))
+static uint16_t present_count, present_index;
+static uint8_t present_row;
+static const fb_pixel_t *present_frame;
+static uint8_t present_top; // physical row held in present_frame[0]
+static ST7735_FrameStats frame_stats;
+
+#if ST7735_FB_INDEXED
+// palette in panel format; new colors are given the next free entry
+static uint16_t fb_palette[256];
+static uint16_t fb_palette_used = 1; // entry 0 is black
+
+// recently converted colors, so repeated draw calls skip the palette search
+#define FB_PALETTE_CACHE 64
+static uint16_t fb_cache_color[FB_PALETTE_CACHE];
+static uint8_t fb_cache_index[FB_PALETTE_CACHE];
+static bool fb_cache_valid[FB_PALETTE_CACHE];
+
+// rows are expanded to RGB565 here while the previous one is on the wire
+typedef struct
+{
+    const fb_pixel_t *src;
+    uint16_t count;
+    int16_t window; // region to open before these pixels, -1 for none
+} fb_segment_t;
+
+static uint16_t scan_lines[2][FB_WIDTH];
+static fb_segment_t scan_segs[2];
+static int scan_cur;
+#endif
 
 // logical drawing area (depends on rotation)
+#if ST7735_ROTATION >= 0
+static const uint8_t _rotation = ST7735_ROTATION & 3;
+static const int16_t _width = (_rotation & 1) ? ST7735_HEIGHT : ST7735_WIDTH;
+static const int16_t _height = (_rotation & 1) ? ST7735_WIDTH : ST7735_HEIGHT;
+#else
 static int16_t _width = ST7735_WIDTH, _height = ST7735_HEIGHT;
-static uint8_t _xstart = ST7735_XSTART, _ystart = ST7735_YSTART;
-static uint8_t _data_rotation[4] = {ST7735_MADCTL_MX, ST7735_MADCTL_MY, ST7735_MADCTL_MV, ST7735_MADCTL_BGR};
 static uint8_t _rotation = 0; // 0..3
+// MADCTL bits ST7735_SetRotation() combines
+static const uint8_t _data_rotation[4] = {ST7735_MADCTL_MX, ST7735_MADCTL_MY, ST7735_MADCTL_MV, ST7735_COLOR_ORDER};
+#endif
+static uint8_t _xstart = ST7735_XSTART, _ystart = ST7735_YSTART;
 
 uint16_t rgb565_to_bgr565(uint16_t rgb565) {
     uint8_t r = (rgb565 >> 11) & 0x1F;
@@ -77,70 +166,66 @@ uint16_t rgb565_to_bgr565(uint16_t rgb565) {
     return ((uint16_t)b << 11) | ((uint16_t)g << 5) | (uint16_t)r;
 }
 
-// Инициализация SPI
-static void ST7735_SPI_Init()
+// color as the panel takes it
+static inline uint16_t fb_panel_color(uint16_t rgb565)
 {
-    spi_init(spi_default, 62500 * 1000); // 62.5 MHz (максимум для RP2040)
-
-    gpio_set_function(PIN_LCD_DIN, GPIO_FUNC_SPI);
-    gpio_set_function(PIN_LCD_CLK, GPIO_FUNC_SPI);
-
-    // Инициализация управляющих пинов
-    gpio_init(PIN_LCD_CS);
-    gpio_init(PIN_LCD_DC);
-    gpio_init(PIN_LCD_RST);
-    gpio_init(PIN_LCD_BL);
-
-    gpio_set_dir(PIN_LCD_CS, GPIO_OUT);
-    gpio_set_dir(PIN_LCD_DC, GPIO_OUT);
-    gpio_set_dir(PIN_LCD_RST, GPIO_OUT);
-    gpio_set_dir(PIN_LCD_BL, GPIO_OUT);
-
-    gpio_put(PIN_LCD_CS, 1);
-    gpio_put(PIN_LCD_DC, 1);
-    gpio_put(PIN_LCD_BL, 1); // Включить подсветку
+#if ST7735_FB_NATIVE
+    return rgb565;
+#else
+    return rgb565_to_bgr565(rgb565);
+#endif
 }
 
-static void ST7735_Reset()
+#if ST7735_FB_INDEXED
+// Palette entry for a color: existing entry, else the next free one, else
+// the closest entry once all 256 are taken
+static uint8_t fb_palette_index(uint16_t rgb565)
 {
-    gpio_put(PIN_LCD_RST, 0);
-    sleep_ms(100);
-    gpio_put(PIN_LCD_RST, 1);
-    sleep_ms(100);
-}
+    uint16_t c = fb_panel_color(rgb565);
+    uint32_t slot = (c ^ (c >> 6) ^ (c >> 11)) & (FB_PALETTE_CACHE - 1);
+    if (fb_cache_valid[slot] && fb_cache_color[slot] == c)
+        return fb_cache_index[slot];
+
+    uint16_t best = 0;
+    uint32_t best_dist = 0xFFFFFFFF;
+    for (uint16_t i = 0; i < fb_palette_used && best_dist; ++i)
+    {
+        int32_t dr = (int32_t)(fb_palette[i] >> 11) - (c >> 11);
+        int32_t dg = (int32_t)((fb_palette[i] >> 5) & 0x3F) - ((c >> 5) & 0x3F);
+        int32_t db = (int32_t)(fb_palette[i] & 0x1F) - (c & 0x1F);
+        uint32_t dist = 4 * dr * dr + dg * dg + 4 * db * db;
+        if (dist < best_dist)
+        {
+            best_dist = dist;
+            best = i;
+        }
+    }
+    if (best_dist && fb_palette_used < 256)
+    {
+        best = fb_palette_used++;
+        fb_palette[best] = c;
+    }
 
-// Отправка команды на дисплей
-static void ST7735_WriteCommand(uint8_t cmd)
-{
-    gpio_put(PIN_LCD_CS, 0); // Активировать чип
-    gpio_put(PIN_LCD_DC, 0); // Командный режим
-    spi_write_blocking(spi_default, &cmd, 1);
-    gpio_put(PIN_LCD_CS, 1); // Деактивировать чип
+    fb_cache_valid[slot] = true;
+    fb_cache_color[slot] = c;
+    fb_cache_index[slot] = best;
+    return best;
 }
+#endif
 
-// Отправка данных на дисплей
-static void ST7735_WriteData(uint8_t *data, size_t buff_size)
+// color as stored in the framebuffer; converted once per draw call, not per pixel
+static inline fb_pixel_t fb_color(uint16_t rgb565)
 {
-    gpio_put(PIN_LCD_CS, 0); // Активировать чип
-    gpio_put(PIN_LCD_DC, 1); // Режим данных
-    spi_write_blocking(spi_default, data, buff_size);
-    gpio_put(PIN_LCD_CS, 1); // Деактивировать чип
+#if ST7735_FB_INDEXED
+    return fb_palette_index(rgb565);
+#else
+    return fb_panel_color(rgb565);
+#endif
 }
 
 static void ST7735_SetAddressWindow(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
 {
-    // column address set
-    ST7735_WriteCommand(ST7735_CASET);
-    uint8_t dataCol[] = {0x00, (uint8_t)(x0 + _xstart), 0x00, (uint8_t)(x1 + _xstart)};
-    ST7735_WriteData(dataCol, sizeof(dataCol));
-
-    // row address set
-    ST7735_WriteCommand(ST7735_RASET);
-    uint8_t dataRow[] = {0x00, (uint8_t)(y0 + _ystart), 0x00, (uint8_t)(y1 + _ystart)};
-    ST7735_WriteData(dataRow, sizeof(dataRow));
-
-    // write to RAM
-    ST7735_WriteCommand(ST7735_RAMWR);
+    st7735_port_window(x0 + _xstart, y0 + _ystart, x1 + _xstart, y1 + _ystart);
 }
 
 static void ST7735_ExecuteCommandList(const uint8_t *addr)
@@ -153,138 +238,348 @@ static void ST7735_ExecuteCommandList(const uint8_t *addr)
     {
         uint8_t cmd = *addr++;
 
-        ST7735_WriteCommand(cmd);
-
         numArgs = *addr++;
         // If high bit set, delay follows args
         ms = numArgs & DELAY;
         numArgs &= ~DELAY;
 
-        if (numArgs)
-        {
-            ST7735_WriteData((uint8_t *)addr, numArgs);
-            addr += numArgs;
-        }
+        st7735_port_command(cmd, addr, numArgs);
+        addr += numArgs;
 
         if (ms)
         {
             ms = *addr++;
             if (ms == 255)
                 ms = 500;
-            sleep_ms(ms);
+            st7735_port_delay_ms(ms);
         }
     }
 }
 
 // ---------- Framebuffer helpers ----------
 
-// Map logical (x,y) (0.._width-1, 0.._height-1) to physical framebuffer coords (px,py)
-static inline void map_logical_to_physical(int16_t x, int16_t y, int16_t *px, int16_t *py)
+// Logical (x,y) (0..width-1, 0..height-1) to physical framebuffer mapping for
+// one rotation. Everything here is a compile-time constant, so the per-pixel
+// and per-span code below carries no rotation switch.
+template <uint8_t ROT>
+struct fb_map
 {
-    switch (_rotation & 3)
+    static constexpr int16_t width = (ROT & 1) ? FB_HEIGHT : FB_WIDTH;
+    static constexpr int16_t height = (ROT & 1) ? FB_WIDTH : FB_HEIGHT;
+
+    static inline int16_t px(int16_t x, int16_t y)
     {
-    case 0:
-        *px = x;
-        *py = y;
-        break;
-    case 1:
-        *px = y;
-        *py = (FB_HEIGHT - 1) - x;
-        break;
-    case 2:
-        *px = (FB_WIDTH - 1) - x;
-        *py = (FB_HEIGHT - 1) - y;
-        break;
-    case 3:
-        *px = (FB_WIDTH - 1) - y;
-        *py = x;
-        break;
-    default:
-        *px = x;
-        *py = y;
+        return ROT == 0 ? x : ROT == 1 ? y : ROT == 2 ? (FB_WIDTH - 1) - x : (FB_WIDTH - 1) - y;
     }
-}
+    static inline int16_t py(int16_t x, int16_t y)
+    {
+        return ROT == 0 ? y : ROT == 1 ? (FB_HEIGHT - 1) - x : ROT == 2 ? (FB_HEIGHT - 1) - y : x;
+    }
+
+    // A w x h image seen from the physical framebuffer: which source corner
+    // lands on the physical top-left, and the source step along a physical
+    // row (+1 px) and down to the next one (+1 py), as (pixels, image rows)
+    static constexpr bool src_right = (ROT == 1) || (ROT == 2);
+    static constexpr bool src_bottom = (ROT == 2) || (ROT == 3);
+    static constexpr int8_t px_step_x = ROT == 0 ? 1 : ROT == 2 ? -1 : 0;
+    static constexpr int8_t px_step_row = ROT == 1 ? 1 : ROT == 3 ? -1 : 0;
+    static constexpr int8_t py_step_x = ROT == 1 ? -1 : ROT == 3 ? 1 : 0;
+    static constexpr int8_t py_step_row = ROT == 0 ? 1 : ROT == 2 ? -1 : 0;
+};
+
+// Run a template<uint8_t ROT> helper for the current rotation; a single
+// instantiation when the rotation is fixed at build time
+#if ST7735_ROTATION >= 0
+#define FB_DISPATCH(fn, ...) fn<ST7735_ROTATION & 3>(__VA_ARGS__)
+#else
+#define FB_DISPATCH(fn, ...)         \
+    do                               \
+    {                                \
+        switch (_rotation & 3)       \
+        {                            \
+        case 0:                      \
+            fn<0>(__VA_ARGS__);      \
+            break;                   \
+        case 1:                      \
+            fn<1>(__VA_ARGS__);      \
+            break;                   \
+        case 2:                      \
+            fn<2>(__VA_ARGS__);      \
+            break;                   \
+        default:                     \
+            fn<3>(__VA_ARGS__);      \
+        }                            \
+    } while (0)
+#endif
 
 // Set pixel into framebuffer (no bounds check of physical buffer needed if mapping correct)
-static inline void fb_set_pixel(int16_t x, int16_t y, uint16_t color)
+// pixel is already in framebuffer format (see fb_color)
+template <uint8_t ROT>
+static inline void fb_put(int16_t x, int16_t y, fb_pixel_t pixel)
+{
+    typedef fb_map<ROT> M;
+    // x,y are logical coordinates (0..width-1 / 0..height-1)
+    if ((x < 0) || (y < 0) || (x >= M::width) || (y >= M::height))
+        return;
+    int16_t px = M::px(x, y), py = M::py(x, y);
+#if ST7735_BAND_ROWS
+    if ((py < fb_band_y0) || (py > fb_band_y1))
+        return;
+#endif
+    framebuffer[(py - fb_band_y0) * FB_WIDTH + px] = pixel;
+    fb_dirty[py >> FB_TILE_SHIFT] |= 1u << (px >> FB_TILE_SHIFT);
+}
+
+static inline void fb_set_pixel(int16_t x, int16_t y, fb_pixel_t pixel)
+{
+    FB_DISPATCH(fb_put, x, y, pixel);
+}
+
+// ---------- Span raster core ----------
+// Rectangle and image calls clip once, map their rectangle to the physical
+// framebuffer once and then write whole physical rows.
+
+// physical rectangle, inclusive
+typedef struct
+{
+    int16_t x0, y0, x1, y1;
+} fb_rect_t;
+
+// Clip a logical rectangle to the drawing area; false if nothing is left
+template <uint8_t ROT>
+static inline bool fb_clip(int16_t *x, int16_t *y, int16_t *w, int16_t *h)
 {
-    // x,y are logical coordinates (0.._width-1 / 0.._height-1)
-    if ((x < 0) || (y < 0) || (x >= _width) || (y >= _height))
+    int32_t x0 = *x, y0 = *y, x1 = x0 + *w, y1 = y0 + *h;
+    if (x0 < 0)
+        x0 = 0;
+    if (y0 < 0)
+        y0 = 0;
+    if (x1 > fb_map<ROT>::width)
+        x1 = fb_map<ROT>::width;
+    if (y1 > fb_map<ROT>::height)
+        y1 = fb_map<ROT>::height;
+    if ((x0 >= x1) || (y0 >= y1))
+        return false;
+    *x = x0;
+    *y = y0;
+    *w = x1 - x0;
+    *h = y1 - y0;
+    return true;
+}
+
+// Physical rectangle covered by a clipped logical rectangle
+template <uint8_t ROT>
+static inline fb_rect_t fb_map_rect(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+    typedef fb_map<ROT> M;
+    int16_t ax = M::px(x, y), ay = M::py(x, y);
+    int16_t bx = M::px(x + w - 1, y + h - 1), by = M::py(x + w - 1, y + h - 1);
+    fb_rect_t r;
+    r.x0 = min(ax, bx);
+    r.y0 = min(ay, by);
+    r.x1 = (ax > bx) ? ax : bx;
+    r.y1 = (ay > by) ? ay : by;
+    return r;
+}
+
+// Trim a physical rectangle to the rows held in the framebuffer; false if
+// nothing is left. Always true outside band mode.
+static inline bool fb_clip_band(fb_rect_t *r)
+{
+#if ST7735_BAND_ROWS
+    if (r->y0 < fb_band_y0)
+        r->y0 = fb_band_y0;
+    if (r->y1 > fb_band_y1)
+        r->y1 = fb_band_y1;
+    return r->y0 <= r->y1;
+#else
+    (void)r;
+    return true;
+#endif
+}
+
+static inline void fb_mark_dirty(const fb_rect_t *r)
+{
+    uint16_t bits = ((2u << (r->x1 >> FB_TILE_SHIFT)) - 1) & ~((1u << (r->x0 >> FB_TILE_SHIFT)) - 1);
+    for (int ty = r->y0 >> FB_TILE_SHIFT; ty <= (r->y1 >> FB_TILE_SHIFT); ++ty)
+        fb_dirty[ty] |= bits;
+}
+
+// Fill n pixels from dst on, FB_PER_WORD pixels per 32-bit store
+static inline void fb_fill_span(fb_pixel_t *dst, uint32_t n, fb_pixel_t pixel)
+{
+    for (; ((uintptr_t)dst & (sizeof(fb_word_t) - 1)) && n; n--)
+        *dst++ = pixel;
+    uint32_t word = (uint32_t)pixel * (sizeof(fb_pixel_t) == 1 ? 0x01010101u : 0x00010001u);
+    fb_word_t *d = (fb_word_t *)dst;
+    for (; n >= 4 * FB_PER_WORD; n -= 4 * FB_PER_WORD, d += 4)
+    {
+        d[0] = word;
+        d[1] = word;
+        d[2] = word;
+        d[3] = word;
+    }
+    for (; n >= FB_PER_WORD; n -= FB_PER_WORD)
+        *d++ = word;
+    for (dst = (fb_pixel_t *)d; n; n--)
+        *dst++ = pixel;
+}
+
+template <uint8_t ROT>
+static void fb_fill_rect_rot(int16_t x, int16_t y, int16_t w, int16_t h, fb_pixel_t pixel)
+{
+    if (!fb_clip<ROT>(&x, &y, &w, &h))
         return;
-    int16_t px, py;
-    map_logical_to_physical(x, y, &px, &py);
-    if ((px < 0) || (py < 0) || (px >= FB_WIDTH) || (py >= FB_HEIGHT))
+    fb_rect_t r = fb_map_rect<ROT>(x, y, w, h);
+    if (!fb_clip_band(&r))
         return;
-    framebuffer[py * FB_WIDTH + px] = rgb565_to_bgr565(color);
+    fb_mark_dirty(&r);
+
+    uint32_t span = r.x1 - r.x0 + 1;
+    fb_pixel_t *dst = framebuffer + (r.y0 - fb_band_y0) * FB_WIDTH + r.x0;
+    if (span == FB_WIDTH)
+    {
+        // full rows are one contiguous run
+        fb_fill_span(dst, span * (r.y1 - r.y0 + 1), pixel);
+        return;
+    }
+    for (int16_t py = r.y0; py <= r.y1; ++py, dst += FB_WIDTH)
+        fb_fill_span(dst, span, pixel);
 }
 
-// Get pixel from framebuffer (logical coords)
-static inline uint16_t fb_get_pixel(int16_t x, int16_t y)
+static void fb_fill_rect(int16_t x, int16_t y, int16_t w, int16_t h, fb_pixel_t pixel)
 {
-    if ((x < 0) || (y < 0) || (x >= _width) || (y >= _height))
-        return 0;
-    int16_t px, py;
-    map_logical_to_physical(x, y, &px, &py);
-    if ((px < 0) || (py < 0) || (px >= FB_WIDTH) || (py >= FB_HEIGHT))
-        return 0;
-    return framebuffer[py * FB_WIDTH + px];
+    FB_DISPATCH(fb_fill_rect_rot, x, y, w, h, pixel);
+}
+
+// Copy a w x h image that lies fully inside the drawing area
+template <uint8_t ROT>
+static void fb_blit_rot(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *data)
+{
+    typedef fb_map<ROT> M;
+    fb_rect_t r = fb_map_rect<ROT>(x, y, w, h);
+    int16_t top = r.y0;
+    if (!fb_clip_band(&r))
+        return;
+    fb_mark_dirty(&r);
+
+    const uint16_t *src = data + (M::src_bottom ? (h - 1) * w : 0) + (M::src_right ? w - 1 : 0);
+    const int32_t step_px = M::px_step_x + M::px_step_row * w;
+    const int32_t step_py = M::py_step_x + M::py_step_row * w;
+    src += (r.y0 - top) * step_py;
+
+    uint32_t span = r.x1 - r.x0 + 1;
+    fb_pixel_t *dst = framebuffer + (r.y0 - fb_band_y0) * FB_WIDTH + r.x0;
+    for (int16_t py = r.y0; py <= r.y1; ++py, dst += FB_WIDTH, src += step_py)
+    {
+#if ST7735_FB_NATIVE && !ST7735_FB_INDEXED
+        if (M::px_step_x == 1)
+        {
+            // source rows run along physical rows
+            memcpy(dst, src, span * sizeof(uint16_t));
+            continue;
+        }
+#endif
+        const uint16_t *s = src;
+        for (uint32_t i = 0; i < span; ++i, s += step_px)
+            dst[i] = fb_color(*s);
+    }
+}
+
+// One glyph; the rotation is resolved once per character, not per pixel
+template <uint8_t ROT>
+static void fb_glyph_rot(int16_t x, int16_t y, const uint16_t *rows, const FontDef *font, fb_pixel_t pixel)
+{
+    for (uint32_t i = 0; i < font->height; i++)
+    {
+        uint32_t b = rows[i];
+        for (uint32_t j = 0; j < font->width; j++)
+        {
+            if ((b << j) & 0x8000)
+            {
+                fb_put<ROT>(x + j, y + i, pixel);
+            }
+        }
+    }
+}
+
+// Logical rectangle covering the physical rows held in the framebuffer
+template <uint8_t ROT>
+static void fb_held_rect(int16_t *x, int16_t *y, int16_t *w, int16_t *h)
+{
+    typedef fb_map<ROT> M;
+    // physical rows run along logical x (rotation 1, 3) or y (0, 2), one per step
+    int16_t a = fb_band_y0 - M::py(0, 0), b = fb_band_y1 - M::py(0, 0);
+    int8_t step = M::py_step_x ? M::py_step_x : M::py_step_row;
+    a *= step;
+    b *= step;
+    int16_t lo = min(a, b), n = ((a > b) ? a : b) - lo + 1;
+    *x = M::py_step_x ? lo : 0;
+    *y = M::py_step_x ? 0 : lo;
+    *w = M::py_step_x ? n : M::width;
+    *h = M::py_step_x ? M::height : n;
 }
 
 // Fill entire framebuffer with color
 void ST7735_FillBuffer(uint16_t color)
 {
-    for (uint32_t i = 0; i < (uint32_t)FB_WIDTH * (uint32_t)FB_HEIGHT; ++i)
-        framebuffer[i] = color;
+    fb_fill_span(framebuffer, sizeof(framebuffers[0]) / sizeof(fb_pixel_t), fb_color(color));
 }
 
 // ---------- Public API (drawing now writes only to framebuffer) ----------
 
 void ST7735_Init(void)
 {
-    ST7735_SPI_Init();
-
-    gpio_put(PIN_LCD_CS, 0);
-
-    ST7735_Reset();
+    st7735_port_init();
+    st7735_port_reset();
 
     ST7735_ExecuteCommandList(init_cmds1);
     ST7735_ExecuteCommandList(init_cmds2);
     ST7735_ExecuteCommandList(init_cmds3);
 
-    gpio_put(PIN_LCD_CS, 1);
-
-    ST7735_FillBuffer(0x0000);
+    for (uint32_t i = 0; i < sizeof(framebuffers) / sizeof(framebuffers[0]); ++i)
+    {
+        framebuffer = framebuffers[i];
+        ST7735_FillBuffer(0x0000);
+    }
+    framebuffer = framebuffers[0];
+    panel_frame = NULL;
+#if ST7735_ROTATION < 0
     _rotation = 1;
     _width = ST7735_HEIGHT;
     _height = ST7735_WIDTH;
+#endif
+}
+
+int16_t ST7735_GetWidth()
+{
+    return _width;
+}
+
+int16_t ST7735_GetHeight()
+{
+    return _height;
+}
+
+void ST7735_GetDrawBounds(int16_t *x, int16_t *y, int16_t *w, int16_t *h)
+{
+    FB_DISPATCH(fb_held_rect, x, y, w, h);
 }
 
 void ST7735_DrawPixel(uint16_t x, uint16_t y, uint16_t color)
 {
-    fb_set_pixel(x, y, color);
+    fb_set_pixel(x, y, fb_color(color));
 }
 
 void ST7735_FillScreen(uint16_t color)
 {
-    for (int16_t y = 0; y < _height; ++y)
-        for (int16_t x = 0; x < _width; ++x)
-            fb_set_pixel(x, y, color);
+    fb_fill_rect(0, 0, _width, _height, fb_color(color));
 }
 
 void ST7735_DrawChar(uint16_t x, uint16_t y, char ch, FontDef font, uint16_t color)
 {
-    uint32_t i, b, j;
-    for (i = 0; i < font.height; i++)
-    {
-        b = font.data[(ch - 32) * font.height + i];
-        for (j = 0; j < font.width; j++)
-        {
-            if ((b << j) & 0x8000)
-            {
-                ST7735_DrawPixel(x + j, y + i, color);
-            }
-        }
-    }
+    const uint16_t *rows = &font.data[(ch - 32) * font.height];
+    FB_DISPATCH(fb_glyph_rot, x, y, rows, &font, fb_color(color));
 }
 
 void ST7735_DrawString(uint16_t x, uint16_t y, const char *str, FontDef font, uint16_t color)
@@ -322,9 +617,7 @@ void ST7735_DrawRectFill(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_
     if ((y + h - 1) >= _height)
         h = _height - y;
 
-    for (uint16_t yy = 0; yy < h; yy++)
-        for (uint16_t xx = 0; xx < w; xx++)
-            fb_set_pixel(x + xx, y + yy, color);
+    fb_fill_rect(x, y, w, h, fb_color(color));
 }
 
 void ST7735_DrawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
@@ -342,8 +635,7 @@ void ST7735_DrawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
     if ((y + h - 1) >= _height)
         h = _height - y;
 
-    for (int16_t i = 0; i < h; ++i)
-        fb_set_pixel(x, y + i, color);
+    fb_fill_rect(x, y, 1, h, fb_color(color));
 }
 
 void ST7735_DrawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
@@ -353,8 +645,7 @@ void ST7735_DrawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
     if ((x + w - 1) >= _width)
         w = _width - x;
 
-    for (int16_t i = 0; i < w; ++i)
-        fb_set_pixel(x + i, y, color);
+    fb_fill_rect(x, y, w, 1, fb_color(color));
 }
 
 void ST7735_DrawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color)
@@ -576,12 +867,6 @@ void ST7735_DrawTriangleFill(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int
 #ifdef FAST_LINE
 void ST7735_DrawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
 {
-
-uint8_t data[] = {
-    static_cast<uint8_t>(color >> 8),
-    static_cast<uint8_t>(color & 0xFF)
-};
-
     int16_t steep = abs(y1 - y0) > abs(x1 - x0);
     if (steep)
     {
@@ -729,15 +1014,17 @@ void ST7735_DrawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t co
 
 void ST7735_SetRotation(uint8_t rotation)
 {
+#if ST7735_ROTATION >= 0
+    (void)rotation; // fixed at build time
+#else
     _rotation = rotation & 3;
-    ST7735_WriteCommand(ST7735_MADCTL);
 
     switch (_rotation)
     {
     case 0:
     {
         uint8_t d_r = (_data_rotation[0] | _data_rotation[1] | _data_rotation[3]);
-        ST7735_WriteData(&d_r, sizeof(d_r));
+        st7735_port_command(ST7735_MADCTL, &d_r, sizeof(d_r));
         _width = ST7735_WIDTH;
         _height = ST7735_HEIGHT;
         _xstart = ST7735_XSTART;
@@ -747,7 +1034,7 @@ void ST7735_SetRotation(uint8_t rotation)
     case 1:
     {
         uint8_t d_r = (_data_rotation[1] | _data_rotation[2] | _data_rotation[3]);
-        ST7735_WriteData(&d_r, sizeof(d_r));
+        st7735_port_command(ST7735_MADCTL, &d_r, sizeof(d_r));
         _width = ST7735_HEIGHT;
         _height = ST7735_WIDTH;
         _xstart = ST7735_YSTART;
@@ -757,7 +1044,7 @@ void ST7735_SetRotation(uint8_t rotation)
     case 2:
     {
         uint8_t d_r = _data_rotation[3];
-        ST7735_WriteData(&d_r, sizeof(d_r));
+        st7735_port_command(ST7735_MADCTL, &d_r, sizeof(d_r));
         _width = ST7735_WIDTH;
         _height = ST7735_HEIGHT;
         _xstart = ST7735_XSTART;
@@ -767,7 +1054,7 @@ void ST7735_SetRotation(uint8_t rotation)
     case 3:
     {
         uint8_t d_r = (_data_rotation[0] | _data_rotation[2] | _data_rotation[3]);
-        ST7735_WriteData(&d_r, sizeof(d_r));
+        st7735_port_command(ST7735_MADCTL, &d_r, sizeof(d_r));
         _width = ST7735_HEIGHT;
         _height = ST7735_WIDTH;
         _xstart = ST7735_YSTART;
@@ -775,6 +1062,7 @@ void ST7735_SetRotation(uint8_t rotation)
     }
     break;
     }
+#endif
 }
 
 // Draw image from array of uint16_t (RGB565). Source data assumed MSB-first per 16-bit value
@@ -787,55 +1075,329 @@ void ST7735_DrawImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint
     if ((y + h - 1) >= _height)
         return;
 
-    for (uint16_t yy = 0; yy < h; ++yy)
-    {
-        for (uint16_t xx = 0; xx < w; ++xx)
-        {
-            uint16_t color = data[yy * w + xx];
-            ST7735_DrawPixel(x + xx, y + yy, color);
-        }
-    }
+    FB_DISPATCH(fb_blit_rot, x, y, w, h, data);
 }
 
 void ST7735_BacklightOn()
 {
-    gpio_put(PIN_LCD_BL, 1);
+    st7735_port_backlight(true);
 }
 
 void ST7735_BacklightOff()
 {
-    gpio_put(PIN_LCD_BL, 0);
+    st7735_port_backlight(false);
 }
 
 void ST7735_InvertColors(bool invert)
 {
-    ST7735_WriteCommand(invert ? ST7735_INVON : ST7735_INVOFF);
+    st7735_port_command(invert ? ST7735_INVON : ST7735_INVOFF, NULL, 0);
 }
 
-// send buffer to display
-void ST7735_Update()
+// true if the tile differs between the two buffers
+#if !ST7735_BAND_ROWS
+static bool fb_tile_changed(const fb_pixel_t *a, const fb_pixel_t *b, int tx, int ty)
 {
-    ST7735_SetAddressWindow(0, 0, FB_WIDTH - 1, FB_HEIGHT - 1);
+    uint32_t offset = (uint32_t)(ty << FB_TILE_SHIFT) * FB_WIDTH + (tx << FB_TILE_SHIFT);
+    const fb_word_t *pa = (const fb_word_t *)(a + offset);
+    const fb_word_t *pb = (const fb_word_t *)(b + offset);
+    for (int row = 0; row < FB_TILE; ++row)
+    {
+        for (uint32_t i = 0; i < FB_TILE / FB_PER_WORD; ++i)
+            if (pa[i] != pb[i])
+                return true;
+        pa += FB_WIDTH / FB_PER_WORD;
+        pb += FB_WIDTH / FB_PER_WORD;
+    }
+    return false;
+}
+
+// Turn the dirty tiles into regions: horizontal runs of tiles per tile row,
+// merged downwards while the run keeps the same columns. With a reference
+// (what the panel shows) tiles that were redrawn unchanged are dropped.
+static void present_collect(const fb_pixel_t *frame, const fb_pixel_t *ref, bool full)
+{
+    present_count = 0;
+    frame_stats.bytes = 0;
+
+    for (int ty = 0; ty < FB_TILE_ROWS; ++ty)
+    {
+        uint32_t bits = full ? (1u << FB_TILE_COLS) - 1 : fb_dirty[ty];
+        fb_dirty[ty] = 0;
+
+        if (ref && !full)
+            for (int tx = 0; tx < FB_TILE_COLS; ++tx)
+                if ((bits & (1u << tx)) && !fb_tile_changed(frame, ref, tx, ty))
+                    bits &= ~(1u << tx);
+
+        while (bits)
+        {
+            int start = __builtin_ctz(bits);
+            int len = __builtin_ctz(~(bits >> start));
+            bits &= ~(((1u << len) - 1) << start);
+
+            uint8_t x0 = start << FB_TILE_SHIFT;
+            uint8_t x1 = ((start + len) << FB_TILE_SHIFT) - 1;
+            uint8_t y0 = ty << FB_TILE_SHIFT;
+
+            bool merged = false;
+            for (uint16_t i = 0; i < present_count && !merged; ++i)
+            {
+                fb_region_t *r = &present_regions[i];
+                if (r->x0 == x0 && r->x1 == x1 && r->y1 + 1 == y0)
+                {
+                    r->y1 = y0 + FB_TILE - 1;
+                    merged = true;
+                }
+            }
+            if (!merged)
+            {
+                fb_region_t *r = &present_regions[present_count++];
+                r->x0 = x0;
+                r->x1 = x1;
+                r->y0 = y0;
+                r->y1 = y0 + FB_TILE - 1;
+            }
+            // CASET + 4, RASET + 4, RAMWR, then the pixels
+            frame_stats.bytes += (uint32_t)(x1 - x0 + 1) * FB_TILE * 2;
+        }
+    }
+
+    frame_stats.regions = present_count;
+    frame_stats.bytes += present_count * 11u;
+}
+#endif
+
+#if ST7735_FB_INDEXED
+// Next run of framebuffer pixels to send: at most one row, so it fits a
+// scan line; false once every region is done
+static bool present_next(fb_segment_t *seg)
+{
+    while (present_index < present_count)
+    {
+        const fb_region_t *r = &present_regions[present_index];
+        if (present_row > r->y1)
+        {
+            present_index++;
+            if (present_index < present_count && present_index < PRESENT_MAX)
+                present_row = present_regions[present_index].y0;
+            continue;
+        }
+        seg->window = (present_row == r->y0) ? (int16_t)present_index : -1;
+        seg->src = present_frame + (present_row - present_top) * FB_WIDTH + r->x0;
+        seg->count = r->x1 - r->x0 + 1;
+        present_row++;
+        return true;
+    }
+    return false;
+}
+
+// Fill scan line b with the next segment; count 0 once the frame is done
+static void scan_fill(int b)
+{
+    fb_segment_t *seg = &scan_segs[b];
+    if (!present_next(seg))
+    {
+        seg->count = 0;
+        return;
+    }
+    for (uint16_t i = 0; i < seg->count; ++i)
+        scan_lines[b][i] = fb_palette[seg->src[i]];
+}
 
-    uint8_t rowbuf[FB_WIDTH * 2];
+static void present_step(void);
 
-    gpio_put(PIN_LCD_CS, 0);
-    gpio_put(PIN_LCD_DC, 1);
+static void scan_send(int b)
+{
+    const fb_segment_t *seg = &scan_segs[b];
+    if (seg->window >= 0)
+    {
+        const fb_region_t *r = &present_regions[seg->window];
+        ST7735_SetAddressWindow(r->x0, r->y0, r->x1, r->y1);
+    }
+    st7735_port_pixels_async(scan_lines[b], seg->count, present_step);
+}
 
-    for (int py = 0; py < FB_HEIGHT; ++py)
+// Scan line scan_cur is done: send the other one, already expanded, and
+// refill this one while it is on the wire; chained as the transfer-done callback
+static void present_step(void)
+{
+    scan_cur ^= 1;
+    if (!scan_segs[scan_cur].count)
+    {
+        present_busy = false;
+        return;
+    }
+    scan_send(scan_cur);
+    scan_fill(scan_cur ^ 1);
+}
+#else
+// Send the next run of pixels; chained as the transfer-done callback, so on
+// the device the whole frame is walked from the DMA interrupt
+static void present_step(void)
+{
+    while (present_index < present_count)
     {
-        for (int px = 0; px < FB_WIDTH; ++px)
+        const fb_region_t *r = &present_regions[present_index];
+        if (present_row > r->y1)
+        {
+            present_index++;
+            if (present_index < present_count && present_index < PRESENT_MAX)
+                present_row = present_regions[present_index].y0;
+            continue;
+        }
+
+        if (present_row == r->y0)
+            ST7735_SetAddressWindow(r->x0, r->y0, r->x1, r->y1);
+
+        const uint16_t *src = present_frame + (present_row - present_top) * FB_WIDTH + r->x0;
+        size_t count;
+        if (r->x0 == 0 && r->x1 == FB_WIDTH - 1)
         {
-            uint16_t c = framebuffer[py * FB_WIDTH + px];
-            rowbuf[px * 2 + 0] = (uint8_t)(c >> 8);   // MSB
-            rowbuf[px * 2 + 1] = (uint8_t)(c & 0xFF); // LSB
+            // full-width rows are contiguous in the framebuffer
+            count = (size_t)(r->y1 - present_row + 1) * FB_WIDTH;
+            present_row = r->y1 + 1;
         }
-        spi_write_blocking(spi_default, rowbuf, FB_WIDTH * 2);
+        else
+        {
+            count = r->x1 - r->x0 + 1;
+            present_row++;
+        }
+        st7735_port_pixels_async(src, count, present_step);
+        return;
     }
+    present_busy = false;
+}
+#endif
 
-    gpio_put(PIN_LCD_CS, 1);
+// Stream the regions in present_regions[0..present_count) out of frame
+static void present_run(const fb_pixel_t *frame, uint8_t top)
+{
+    present_frame = frame;
+    present_top = top;
+    present_index = 0;
+    present_row = present_count ? present_regions[0].y0 : 0;
+    present_busy = true;
+#if ST7735_FB_INDEXED
+    // both scan lines are expanded before the first transfer starts, so the
+    // done callback never races the expansion here
+    scan_cur = 0;
+    scan_fill(0);
+    if (!scan_segs[0].count)
+    {
+        present_busy = false;
+        return;
+    }
+    scan_fill(1);
+    scan_send(0);
+#else
+    present_step();
+#endif
 }
 
+void ST7735_WaitIdle()
+{
+    while (present_busy)
+        st7735_port_poll();
+}
+
+#if ST7735_BAND_ROWS
+void ST7735_FirstBand()
+{
+    fb_band_y0 = 0;
+    fb_band_y1 = ST7735_BAND_ROWS - 1;
+    frame_stats.bytes = 0;
+    frame_stats.regions = 0;
+    // the other band buffer may still be on the wire; this one is free
+    fb_fill_span(framebuffer, sizeof(framebuffers[0]) / sizeof(fb_pixel_t), 0);
+}
+
+bool ST7735_NextBand()
+{
+    if (fb_band_y1 > FB_HEIGHT - 1)
+        fb_band_y1 = FB_HEIGHT - 1;
+
+    // the previous band has had this band's whole render time to go out
+    ST7735_WaitIdle();
+    fb_region_t *r = &present_regions[0];
+    r->x0 = 0;
+    r->x1 = FB_WIDTH - 1;
+    r->y0 = fb_band_y0;
+    r->y1 = fb_band_y1;
+    present_count = 1;
+    frame_stats.bytes += (uint32_t)(fb_band_y1 - fb_band_y0 + 1) * FB_WIDTH * 2 + 11u;
+    frame_stats.regions++;
+    present_run(framebuffer, fb_band_y0);
+
+    framebuffer = (framebuffer == framebuffers[0]) ? framebuffers[1] : framebuffers[0];
+    if (fb_band_y1 == FB_HEIGHT - 1)
+        return false;
+
+    fb_band_y0 += ST7735_BAND_ROWS;
+    fb_band_y1 += ST7735_BAND_ROWS;
+    fb_fill_span(framebuffer, sizeof(framebuffers[0]) / sizeof(fb_pixel_t), 0);
+    return true;
+}
+#else
+static void present_start(const fb_pixel_t *frame)
+{
+    ST7735_WaitIdle();
+
+    bool full = (panel_frame == NULL);
+    present_collect(frame, (panel_frame != frame) ? panel_frame : NULL, full);
+    panel_frame = frame;
+    present_run(frame, 0);
+}
+
+// send buffer to display
+void ST7735_Update()
+{
+    present_start(framebuffer);
+    ST7735_WaitIdle();
+}
+
+// send buffer to display in the background and flip to the other buffer
+void ST7735_UpdateAsync()
+{
+#if ST7735_DOUBLE_BUFFER
+    const fb_pixel_t *frame = framebuffer;
+    present_start(frame);
+    framebuffer = (framebuffer == framebuffers[0]) ? framebuffers[1] : framebuffers[0];
+#else
+    ST7735_Update();
+#endif
+}
+#endif
+
+void ST7735_Invalidate()
+{
+    ST7735_WaitIdle();
+    panel_frame = NULL;
+}
+
+void ST7735_SetPalette(const uint16_t *colors, uint16_t count)
+{
+#if ST7735_FB_INDEXED
+    ST7735_WaitIdle();
+    if (count > 256)
+        count = 256;
+    for (uint16_t i = 0; i < count; ++i)
+        fb_palette[i] = fb_panel_color(colors[i]);
+    fb_palette_used = count ? count : 1;
+    if (!count)
+        fb_palette[0] = 0;
+    for (uint32_t i = 0; i < FB_PALETTE_CACHE; ++i)
+        fb_cache_valid[i] = false;
+    panel_frame = NULL;
+#else
+    (void)colors;
+    (void)count;
+#endif
+}
+
+ST7735_FrameStats ST7735_GetFrameStats()
+{
+    return frame_stats;
+}
 
 void ST7735_Clear()
 {
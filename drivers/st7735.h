@@ -4,8 +4,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
-#include "pico/stdlib.h"
-#include "hardware/spi.h"
+#include <stdbool.h>
 #include "fonts.h"
 
 #define PIN_LCD_DIN    3   // MOSI (SPI TX)
@@ -26,7 +25,48 @@
 #define ST7735_XSTART 			0
 #define ST7735_YSTART 			0
 
-#define ST7735_DATA_ROTATION (ST7735_MADCTL_MX | ST7735_MADCTL_MY | ST7735_MADCTL_BGR)
+// The framebuffer holds pixels exactly as the panel takes them: MADCTL picks the
+// R/B order, colors are converted once per draw call and present streams the
+// buffer untouched. 0 swaps R/B in software instead (panel in BGR mode).
+#ifndef ST7735_FB_NATIVE
+#define ST7735_FB_NATIVE 1
+#endif
+
+#if ST7735_FB_NATIVE
+#define ST7735_COLOR_ORDER ST7735_MADCTL_RGB
+#else
+#define ST7735_COLOR_ORDER ST7735_MADCTL_BGR
+#endif
+
+#define ST7735_DATA_ROTATION (ST7735_MADCTL_MX | ST7735_MADCTL_MY | ST7735_COLOR_ORDER)
+
+// 8-bit palette-indexed framebuffer: 20 KB per buffer instead of 40 KB.
+// Colors map to palette entries on first use (the closest entry once all 256
+// are taken) and rows are expanded to RGB565 while they are streamed.
+#ifndef ST7735_FB_INDEXED
+#define ST7735_FB_INDEXED 0
+#endif
+
+// Drawing rotation fixed at build time (0..3): the logical -> framebuffer remap
+// and span strides become compile-time constants and ST7735_SetRotation() is
+// ignored. -1 keeps it switchable at run time (ST7735_Init() selects 1).
+#ifndef ST7735_ROTATION
+#define ST7735_ROTATION -1
+#endif
+
+// Band rendering: instead of a whole framebuffer only two bands of this many
+// physical rows are kept (8 rows: 2 x 2 KB). The scene is drawn once per band
+// between ST7735_FirstBand() and ST7735_NextBand(), and each finished band is
+// streamed while the next one is drawn. 0 keeps the full framebuffer.
+#ifndef ST7735_BAND_ROWS
+#define ST7735_BAND_ROWS 0
+#endif
+
+// Two framebuffers: ST7735_UpdateAsync() streams one to the panel over DMA
+// while drawing continues into the other. Set to 0 to keep a single 40 KB buffer.
+#ifndef ST7735_DOUBLE_BUFFER
+#define ST7735_DOUBLE_BUFFER 1
+#endif
 
 #define ST7735_NOP     0x00
 #define ST7735_SWRESET 0x01
@@ -113,6 +153,39 @@ void ST7735_BacklightOn();
 void ST7735_BacklightOff();
 void ST7735_InvertColors(bool invert);
 void ST7735_SetRotation(uint8_t rotation);
+#if ST7735_BAND_ROWS
+// Draw the same scene on every pass; nothing outside the current band is kept:
+//   ST7735_FirstBand();
+//   do { draw(); } while (ST7735_NextBand());
+void ST7735_FirstBand();
+// Send the band just drawn and move on; false after the last band
+bool ST7735_NextBand();
+#else
 void ST7735_Update();
+// Hand the frame to DMA and return; with ST7735_DOUBLE_BUFFER drawing continues
+// in the other buffer, which still holds the frame before last, so redraw it fully
+void ST7735_UpdateAsync();
+#endif
+void ST7735_WaitIdle();
+// logical size for the current rotation
+int16_t ST7735_GetWidth();
+int16_t ST7735_GetHeight();
+// Logical area drawing currently lands in: the current band, or the whole screen
+void ST7735_GetDrawBounds(int16_t *x, int16_t *y, int16_t *w, int16_t *h);
+
+// Only 8x8 tiles written since the last present and actually different from
+// what the panel shows are sent, one address window per merged region
+typedef struct
+{
+    uint32_t bytes;   // SPI bytes of the last present, window setup included
+    uint16_t regions; // address windows issued
+} ST7735_FrameStats;
+
+ST7735_FrameStats ST7735_GetFrameStats();
+// ST7735_FB_INDEXED: load palette entries 0..count-1 up front (fixed indices,
+// no lookups on first use); no effect otherwise
+void ST7735_SetPalette(const uint16_t *colors, uint16_t count);
+// forget what the panel shows; the next present sends the whole frame
+void ST7735_Invalidate();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include <string.h>
+#include "st7735_dl.h"
+#include "st7735_port.h"
+
+void ST7735_DL_Begin(ST7735_DisplayList *dl)
+{
+    dl->count = 0;
+    dl->text_used = 0;
+    memset(&dl->stats, 0, sizeof(dl->stats));
+}
+
+static ST7735_DLCmd *dl_push(ST7735_DisplayList *dl, uint8_t op, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    if (dl->count >= ST7735_DL_MAX_CMDS)
+    {
+        dl->stats.dropped++;
+        return NULL;
+    }
+    ST7735_DLCmd *c = &dl->cmds[dl->count++];
+    c->op = op;
+    c->color = color;
+    c->x = x;
+    c->y = y;
+    c->w = w;
+    c->h = h;
+    c->data = NULL;
+    c->text = 0;
+    return c;
+}
+
+// Grow the previous fill instead of adding one when the two rectangles share
+// a full edge and touch or overlap: board cells and piece blocks of one color
+// then go out as a single span fill per run
+static bool dl_merge_fill(ST7735_DisplayList *dl, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    if (!dl->count || x < 0 || y < 0)
+        return false;
+    ST7735_DLCmd *p = &dl->cmds[dl->count - 1];
+    if (p->op != ST7735_DL_FILL || p->color != color)
+        return false;
+
+    if (p->y == y && p->h == h && x <= p->x + p->w && p->x <= x + w)
+    {
+        int16_t x1 = (p->x + p->w > x + w) ? p->x + p->w : x + w;
+        p->x = (p->x < x) ? p->x : x;
+        p->w = x1 - p->x;
+        return true;
+    }
+    if (p->x == x && p->w == w && y <= p->y + p->h && p->y <= y + h)
+    {
+        int16_t y1 = (p->y + p->h > y + h) ? p->y + p->h : y + h;
+        p->y = (p->y < y) ? p->y : y;
+        p->h = y1 - p->y;
+        return true;
+    }
+    return false;
+}
+
+void ST7735_DL_RectFill(ST7735_DisplayList *dl, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    if (w <= 0 || h <= 0)
+        return;
+    if (dl_merge_fill(dl, x, y, w, h, color))
+    {
+        dl->stats.merged++;
+        return;
+    }
+    dl_push(dl, ST7735_DL_FILL, x, y, w, h, color);
+}
+
+void ST7735_DL_Rect(ST7735_DisplayList *dl, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+    dl_push(dl, ST7735_DL_FRAME, x, y, w, h, color);
+}
+
+void ST7735_DL_FillScreen(ST7735_DisplayList *dl, uint16_t color)
+{
+    // a new background hides everything recorded so far
+    dl->count = 0;
+    dl->text_used = 0;
+    dl_push(dl, ST7735_DL_FILL, 0, 0, ST7735_GetWidth(), ST7735_GetHeight(), color);
+}
+
+static void dl_text_run(ST7735_DisplayList *dl, int16_t x, int16_t y, const char *str, size_t len, const FontDef *font, uint16_t color)
+{
+    if (!len)
+        return;
+    if (dl->text_used + len + 1 > ST7735_DL_TEXT)
+    {
+        dl->stats.dropped++;
+        return;
+    }
+    ST7735_DLCmd *c = dl_push(dl, ST7735_DL_TEXT_RUN, x, y, len * font->width, font->height, color);
+    if (!c)
+        return;
+    c->data = font;
+    c->text = dl->text_used;
+    memcpy(&dl->text[dl->text_used], str, len);
+    dl->text[dl->text_used + len] = '\0';
+    dl->text_used += len + 1;
+}
+
+// Lay the text out like ST7735_DrawString does and record one run per line,
+// so every run has an exact box and replays without wrapping
+void ST7735_DL_String(ST7735_DisplayList *dl, int16_t x, int16_t y, const char *str, const FontDef *font, uint16_t color)
+{
+    const int16_t width = ST7735_GetWidth(), height = ST7735_GetHeight();
+    const char *run = str;
+    int16_t run_x = x;
+    while (*str)
+    {
+        if (x + font->width >= width)
+        {
+            dl_text_run(dl, run_x, y, run, str - run, font, color);
+            x = 0;
+            y += font->height;
+            run = str;
+            run_x = 0;
+            if (y + font->height >= height)
+                return;
+            if (*str == ' ')
+            {
+                run = ++str;
+                continue;
+            }
+        }
+        x += font->width;
+        str++;
+    }
+    dl_text_run(dl, run_x, y, run, str - run, font, color);
+}
+
+void ST7735_DL_Image(ST7735_DisplayList *dl, int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *data)
+{
+    ST7735_DLCmd *c = dl_push(dl, ST7735_DL_BLIT, x, y, w, h, 0);
+    if (c)
+        c->data = data;
+}
+
+void ST7735_DL_Render(ST7735_DisplayList *dl)
+{
+    uint32_t t0 = st7735_port_time_us();
+
+    int16_t bx, by, bw, bh;
+    ST7735_GetDrawBounds(&bx, &by, &bw, &bh);
+
+    for (uint16_t i = 0; i < dl->count; ++i)
+    {
+        const ST7735_DLCmd *c = &dl->cmds[i];
+        if (c->x >= bx + bw || c->x + c->w <= bx || c->y >= by + bh || c->y + c->h <= by)
+        {
+            dl->stats.culled++;
+            continue;
+        }
+
+        switch (c->op)
+        {
+        case ST7735_DL_FILL:
+            ST7735_DrawRectFill(c->x, c->y, c->w, c->h, c->color);
+            break;
+        case ST7735_DL_FRAME:
+            ST7735_DrawRect(c->x, c->y, c->w, c->h, c->color);
+            break;
+        case ST7735_DL_TEXT_RUN:
+            ST7735_DrawString(c->x, c->y, &dl->text[c->text], *(const FontDef *)c->data, c->color);
+            break;
+        case ST7735_DL_BLIT:
+            ST7735_DrawImage(c->x, c->y, c->w, c->h, (const uint16_t *)c->data);
+            break;
+        }
+    }
+
+    dl->stats.raster_us += st7735_port_time_us() - t0;
+}
+
+ST7735_DLStats ST7735_DL_GetStats(const ST7735_DisplayList *dl)
+{
+    ST7735_DLStats stats = dl->stats;
+    stats.commands = dl->count;
+    return stats;
+}
@@ -0,0 +1,76 @@
+#ifndef ST7735_DL_H_
+#define ST7735_DL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "st7735.h"
+
+// Retained display list: draw calls are recorded into a fixed-size buffer
+// and rasterized later in one pass with ST7735_DL_Render(). Recording merges
+// a fill with the previous one when together they form one rectangle; the
+// raster pass skips commands outside the area being drawn (the current band
+// with ST7735_BAND_ROWS), so replaying a list per band is cheap.
+//
+//   ST7735_DL_Begin(&dl);
+//   ST7735_DL_RectFill(&dl, ...); ...
+//   ST7735_DL_Render(&dl);      // once, or once per band
+//   ST7735_UpdateAsync();
+
+#ifndef ST7735_DL_MAX_CMDS
+#define ST7735_DL_MAX_CMDS 256
+#endif
+
+// characters of all glyph runs in a list, terminators included
+#ifndef ST7735_DL_TEXT
+#define ST7735_DL_TEXT 128
+#endif
+
+enum
+{
+    ST7735_DL_FILL,  // solid rectangle
+    ST7735_DL_FRAME, // 1 px rectangle outline
+    ST7735_DL_TEXT_RUN,
+    ST7735_DL_BLIT, // RGB565 image, kept by pointer
+};
+
+typedef struct
+{
+    uint8_t op;
+    uint16_t color;
+    int16_t x, y, w, h;  // bounding box, logical pixels
+    const void *data;    // image pixels, or the FontDef of a glyph run
+    uint16_t text;       // glyph run: offset into the text pool
+} ST7735_DLCmd;
+
+typedef struct
+{
+    uint16_t commands; // recorded, after merging
+    uint16_t merged;   // calls folded into the previous command
+    uint16_t dropped;  // calls that did not fit
+    uint16_t culled;   // commands skipped by the raster passes
+    uint32_t raster_us; // all ST7735_DL_Render() calls since ST7735_DL_Begin()
+} ST7735_DLStats;
+
+typedef struct
+{
+    ST7735_DLCmd cmds[ST7735_DL_MAX_CMDS];
+    char text[ST7735_DL_TEXT];
+    uint16_t count;
+    uint16_t text_used;
+    ST7735_DLStats stats;
+} ST7735_DisplayList;
+
+void ST7735_DL_Begin(ST7735_DisplayList *dl);
+void ST7735_DL_RectFill(ST7735_DisplayList *dl, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+void ST7735_DL_Rect(ST7735_DisplayList *dl, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+void ST7735_DL_FillScreen(ST7735_DisplayList *dl, uint16_t color);
+// str is copied; font must outlive the list (the global Font_* do)
+void ST7735_DL_String(ST7735_DisplayList *dl, int16_t x, int16_t y, const char *str, const FontDef *font, uint16_t color);
+// data is not copied and must stay valid until the list is rendered
+void ST7735_DL_Image(ST7735_DisplayList *dl, int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *data);
+
+// Rasterize the list into the framebuffer (or the current band)
+void ST7735_DL_Render(ST7735_DisplayList *dl);
+ST7735_DLStats ST7735_DL_GetStats(const ST7735_DisplayList *dl);
+
+#endif
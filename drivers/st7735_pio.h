@@ -0,0 +1,32 @@
+#ifndef ST7735_PIO_H_
+#define ST7735_PIO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// TX FIFO words of the st7735_lcd PIO program (st7735_lcd.pio), shared by the
+// device transport and the host model of the program. Each FIFO word carries
+// one 16-bit unit in its upper half.
+
+// longest transfer one header can describe
+#define ST7735_PIO_MAX_BITS  16384
+#define ST7735_PIO_MAX_PIXELS (ST7735_PIO_MAX_BITS / 16)
+
+// header unit for a transfer of bits (a multiple of 8) with DC at dc
+static inline uint32_t st7735_pio_header(bool dc, uint32_t bits)
+{
+    uint32_t unit = ((uint32_t)dc << 15) | ((uint32_t)((bits & 15) != 0) << 14) | (bits - 1);
+    return unit << 16;
+}
+
+// bytes i and i + 1 of buf (n bytes) as one unit, MSB first
+static inline uint32_t st7735_pio_bytes(const uint8_t *buf, size_t i, size_t n)
+{
+    uint32_t unit = (uint32_t)buf[i] << 8;
+    if (i + 1 < n)
+        unit |= buf[i + 1];
+    return unit << 16;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef ST7735_PORT_H_
+#define ST7735_PORT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Transport layer used by st7735.cpp. The device build implements it on top of
+// SPI + DMA (st7735_port_spi.cpp); host builds link a stand-in that records the
+// byte stream into a simulated panel (host/st7735_port_host.cpp).
+
+typedef void (*st7735_port_done_t)(void);
+
+void st7735_port_init(void);
+void st7735_port_reset(void);
+void st7735_port_delay_ms(uint32_t ms);
+void st7735_port_backlight(bool on);
+
+// Send one command byte followed by nargs parameter bytes
+void st7735_port_command(uint8_t cmd, const uint8_t *args, size_t nargs);
+
+// CASET/RASET/RAMWR for the (inclusive) panel window; the panel then expects
+// (x1 - x0 + 1) * (y1 - y0 + 1) pixels
+void st7735_port_window(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+
+// Stream count 16-bit pixels (sent MSB first) without blocking the caller.
+// done() runs once the last bit has left the wire; it may run in interrupt
+// context and may start the next transfer.
+void st7735_port_pixels_async(const uint16_t *pixels, size_t count, st7735_port_done_t done);
+
+// Called while waiting for a transfer to finish
+void st7735_port_poll(void);
+
+// Free-running microsecond clock, for profiling only
+uint32_t st7735_port_time_us(void);
+
+#endif
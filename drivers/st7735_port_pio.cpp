@@ -0,0 +1,153 @@
+#include "st7735.h"
+#include "st7735_port.h"
+#include "st7735_pio.h"
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "st7735_lcd.pio.h"
+
+// PIO transport: one state machine clocks commands and pixels and sequences
+// CS and DC itself, so a window setup is a handful of FIFO writes instead of
+// six gpio_put pairs around blocking SPI writes.
+
+static_assert(PIN_LCD_DC == PIN_LCD_CS + 2, "the PIO program drives CS and DC as SET pins base and base + 2");
+
+// bit clock = sys_clk / (2 * ST7735_PIO_CLKDIV)
+#ifndef ST7735_PIO_CLKDIV
+#define ST7735_PIO_CLKDIV 1.0f
+#endif
+
+static const PIO lcd_pio = pio0;
+static uint lcd_sm;
+static uint lcd_offset;
+
+static int dma_chan = -1;
+static const uint16_t *dma_next;
+static size_t dma_left;
+static volatile st7735_port_done_t dma_done = NULL;
+
+// Header for the next (at most ST7735_PIO_MAX_PIXELS) pixels, then DMA
+// feeds them straight from the framebuffer
+static void pixels_chunk(void)
+{
+    size_t n = (dma_left < ST7735_PIO_MAX_PIXELS) ? dma_left : ST7735_PIO_MAX_PIXELS;
+    pio_sm_put_blocking(lcd_pio, lcd_sm, st7735_pio_header(true, n * 16));
+    const uint16_t *src = dma_next;
+    dma_next += n;
+    dma_left -= n;
+    dma_channel_transfer_from_buffer_now(dma_chan, src, n);
+}
+
+static void __not_in_flash_func(dma_irq_handler)(void)
+{
+    if (dma_chan < 0 || !dma_channel_get_irq0_status(dma_chan))
+        return;
+    dma_channel_acknowledge_irq0(dma_chan);
+
+    if (dma_left)
+    {
+        pixels_chunk();
+        return;
+    }
+
+    // the FIFO is fed; done once the program waits for its next header
+    while (!pio_sm_is_tx_fifo_empty(lcd_pio, lcd_sm) ||
+           pio_sm_get_pc(lcd_pio, lcd_sm) != lcd_offset + st7735_lcd_offset_start)
+        tight_loop_contents();
+
+    st7735_port_done_t done = dma_done;
+    dma_done = NULL;
+    if (done)
+        done();
+}
+
+void st7735_port_init(void)
+{
+    gpio_init(PIN_LCD_RST);
+    gpio_init(PIN_LCD_BL);
+    gpio_set_dir(PIN_LCD_RST, GPIO_OUT);
+    gpio_set_dir(PIN_LCD_BL, GPIO_OUT);
+    gpio_put(PIN_LCD_RST, 1);
+    gpio_put(PIN_LCD_BL, 1);
+
+    lcd_sm = pio_claim_unused_sm(lcd_pio, true);
+    lcd_offset = pio_add_program(lcd_pio, &st7735_lcd_program);
+    st7735_lcd_program_init(lcd_pio, lcd_sm, lcd_offset, PIN_LCD_DIN, PIN_LCD_CLK, PIN_LCD_CS, ST7735_PIO_CLKDIV);
+
+    // pixel channel: 16-bit reads from the framebuffer, paced by the TX FIFO
+    dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(lcd_pio, lcd_sm, true));
+    dma_channel_configure(dma_chan, &c, &lcd_pio->txf[lcd_sm], NULL, 0, false);
+
+    dma_channel_set_irq0_enabled(dma_chan, true);
+    irq_add_shared_handler(DMA_IRQ_0, dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+}
+
+void st7735_port_reset(void)
+{
+    gpio_put(PIN_LCD_RST, 0);
+    sleep_ms(100);
+    gpio_put(PIN_LCD_RST, 1);
+    sleep_ms(100);
+}
+
+void st7735_port_delay_ms(uint32_t ms)
+{
+    sleep_ms(ms);
+}
+
+void st7735_port_backlight(bool on)
+{
+    gpio_put(PIN_LCD_BL, on);
+}
+
+// Queued behind whatever is still in the FIFO; returns without waiting for the wire
+void st7735_port_command(uint8_t cmd, const uint8_t *args, size_t nargs)
+{
+    pio_sm_put_blocking(lcd_pio, lcd_sm, st7735_pio_header(false, 8));
+    pio_sm_put_blocking(lcd_pio, lcd_sm, (uint32_t)cmd << 24);
+    if (!nargs)
+        return;
+    pio_sm_put_blocking(lcd_pio, lcd_sm, st7735_pio_header(true, nargs * 8));
+    for (size_t i = 0; i < nargs; i += 2)
+        pio_sm_put_blocking(lcd_pio, lcd_sm, st7735_pio_bytes(args, i, nargs));
+}
+
+void st7735_port_window(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
+{
+    uint8_t dataCol[] = {0x00, x0, 0x00, x1};
+    uint8_t dataRow[] = {0x00, y0, 0x00, y1};
+    st7735_port_command(ST7735_CASET, dataCol, sizeof(dataCol));
+    st7735_port_command(ST7735_RASET, dataRow, sizeof(dataRow));
+    st7735_port_command(ST7735_RAMWR, NULL, 0);
+}
+
+void st7735_port_pixels_async(const uint16_t *pixels, size_t count, st7735_port_done_t done)
+{
+    if (!count)
+    {
+        if (done)
+            done();
+        return;
+    }
+    dma_done = done;
+    dma_next = pixels;
+    dma_left = count;
+    pixels_chunk();
+}
+
+void st7735_port_poll(void)
+{
+    tight_loop_contents();
+}
+
+uint32_t st7735_port_time_us(void)
+{
+    return time_us_32();
+}
@@ -0,0 +1,144 @@
+#include "st7735.h"
+#include "st7735_port.h"
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+static int dma_chan = -1;
+static volatile st7735_port_done_t dma_done = NULL;
+
+// Отправка команды на дисплей
+static void ST7735_WriteCommand(uint8_t cmd)
+{
+    gpio_put(PIN_LCD_CS, 0); // Активировать чип
+    gpio_put(PIN_LCD_DC, 0); // Командный режим
+    spi_write_blocking(spi_default, &cmd, 1);
+    gpio_put(PIN_LCD_CS, 1); // Деактивировать чип
+}
+
+// Отправка данных на дисплей
+static void ST7735_WriteData(const uint8_t *data, size_t buff_size)
+{
+    gpio_put(PIN_LCD_CS, 0); // Активировать чип
+    gpio_put(PIN_LCD_DC, 1); // Режим данных
+    spi_write_blocking(spi_default, data, buff_size);
+    gpio_put(PIN_LCD_CS, 1); // Деактивировать чип
+}
+
+// DMA finished feeding the FIFO: wait for the last frame to shift out, then
+// release the bus and go back to 8-bit frames for commands
+static void __not_in_flash_func(dma_irq_handler)(void)
+{
+    if (dma_chan < 0 || !dma_channel_get_irq0_status(dma_chan))
+        return;
+    dma_channel_acknowledge_irq0(dma_chan);
+
+    while (spi_is_busy(spi_default))
+        tight_loop_contents();
+    gpio_put(PIN_LCD_CS, 1);
+    spi_set_format(spi_default, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+
+    st7735_port_done_t done = dma_done;
+    dma_done = NULL;
+    if (done)
+        done();
+}
+
+// Инициализация SPI
+void st7735_port_init(void)
+{
+    spi_init(spi_default, 62500 * 1000); // 62.5 MHz (максимум для RP2040)
+
+    gpio_set_function(PIN_LCD_DIN, GPIO_FUNC_SPI);
+    gpio_set_function(PIN_LCD_CLK, GPIO_FUNC_SPI);
+
+    // Инициализация управляющих пинов
+    gpio_init(PIN_LCD_CS);
+    gpio_init(PIN_LCD_DC);
+    gpio_init(PIN_LCD_RST);
+    gpio_init(PIN_LCD_BL);
+
+    gpio_set_dir(PIN_LCD_CS, GPIO_OUT);
+    gpio_set_dir(PIN_LCD_DC, GPIO_OUT);
+    gpio_set_dir(PIN_LCD_RST, GPIO_OUT);
+    gpio_set_dir(PIN_LCD_BL, GPIO_OUT);
+
+    gpio_put(PIN_LCD_CS, 1);
+    gpio_put(PIN_LCD_DC, 1);
+    gpio_put(PIN_LCD_BL, 1); // Включить подсветку
+
+    // pixel channel: 16-bit reads from the framebuffer, paced by SPI TX
+    dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, spi_get_dreq(spi_default, true));
+    dma_channel_configure(dma_chan, &c, &spi_get_hw(spi_default)->dr, NULL, 0, false);
+
+    dma_channel_set_irq0_enabled(dma_chan, true);
+    irq_add_shared_handler(DMA_IRQ_0, dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+}
+
+void st7735_port_reset(void)
+{
+    gpio_put(PIN_LCD_RST, 0);
+    sleep_ms(100);
+    gpio_put(PIN_LCD_RST, 1);
+    sleep_ms(100);
+}
+
+void st7735_port_delay_ms(uint32_t ms)
+{
+    sleep_ms(ms);
+}
+
+void st7735_port_backlight(bool on)
+{
+    gpio_put(PIN_LCD_BL, on);
+}
+
+void st7735_port_command(uint8_t cmd, const uint8_t *args, size_t nargs)
+{
+    ST7735_WriteCommand(cmd);
+    if (nargs)
+        ST7735_WriteData(args, nargs);
+}
+
+void st7735_port_window(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
+{
+    // column address set
+    uint8_t dataCol[] = {0x00, x0, 0x00, x1};
+    st7735_port_command(ST7735_CASET, dataCol, sizeof(dataCol));
+
+    // row address set
+    uint8_t dataRow[] = {0x00, y0, 0x00, y1};
+    st7735_port_command(ST7735_RASET, dataRow, sizeof(dataRow));
+
+    // write to RAM
+    ST7735_WriteCommand(ST7735_RAMWR);
+}
+
+// 16-bit SPI frames put each framebuffer word on the wire MSB first, so the
+// buffer goes out as-is without repacking into bytes
+void st7735_port_pixels_async(const uint16_t *pixels, size_t count, st7735_port_done_t done)
+{
+    spi_set_format(spi_default, 16, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+    gpio_put(PIN_LCD_CS, 0);
+    gpio_put(PIN_LCD_DC, 1);
+
+    dma_done = done;
+    dma_channel_transfer_from_buffer_now(dma_chan, pixels, count);
+}
+
+void st7735_port_poll(void)
+{
+    tight_loop_contents();
+}
+
+uint32_t st7735_port_time_us(void)
+{
+    return time_us_32();
+}
@@ -0,0 +1,808 @@
+#include <stdlib.h>
+#include <string.h>
+#include "tetris_batch.h"
+#include "tetris_queue.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TETRIS_BATCH_X86 1
+#define SSE2 __attribute__((target("sse2")))
+#define AVX2 __attribute__((target("avx2")))
+#endif
+
+// piece tables widened to 32-bit words for the AVX2 gathers, and the
+// piece's four rows shifted into place for every column
+struct BatchPieceTables
+{
+    uint32_t rows[TETRIS_PIECES * 4 * 4]; // [t][r][box row]
+    int32_t bottom[TETRIS_PIECES * 4 * 4]; // [t][r][box column]
+    // [t][r][x + 4], as TETRIS_TABLES.rows << (x + TETRIS_WALL); all ones
+    // where the box would leave the 16-bit row, so the test fails there
+    uint64_t shifted[TETRIS_PIECES * 4 * 16];
+};
+
+static constexpr BatchPieceTables make_piece_tables()
+{
+    BatchPieceTables p{};
+    for (int t = 0; t < TETRIS_PIECES; t++)
+        for (int r = 0; r < 4; r++)
+            for (int i = 0; i < 4; i++)
+            {
+                p.rows[(t * 4 + r) * 4 + i] = (uint32_t)(TETRIS_TABLES.rows[t][r] >> (16 * i)) & 0xF;
+                p.bottom[(t * 4 + r) * 4 + i] = TETRIS_TABLES.bottom[t][r][i];
+            }
+    for (int t = 0; t < TETRIS_PIECES; t++)
+        for (int r = 0; r < 4; r++)
+            for (int x = -4; x < 12; x++)
+            {
+                int shift = x + TETRIS_WALL;
+                p.shifted[(t * 4 + r) * 16 + x + 4] =
+                    (shift >= 0 && shift <= 16 - 4) ? TETRIS_TABLES.rows[t][r] << shift : ~0ull;
+            }
+    return p;
+}
+
+static constexpr BatchPieceTables PIECE = make_piece_tables();
+
+static void *alloc_lanes(size_t bytes)
+{
+    // rounded up for aligned_alloc, plus slack for the 32-bit gathers that
+    // read past the last 16-bit row or column top
+    size_t size = (bytes + 64 + 63) & ~(size_t)63;
+    void *p = aligned_alloc(64, size);
+    if (p)
+        memset(p, 0, size);
+    return p;
+}
+
+// games still in play after the first test of a step
+typedef struct
+{
+    int falls; // hard drops tucked under an overhang, listed in lane[] with
+               // the row below them
+    int turns; // blocked turns, in turn[]
+    int locks; // in locked[]
+} StepLists;
+
+// ---- collision
+
+static inline bool fits_lane(const TetrisBatch *b, int k, int t, int r, int x, int y)
+{
+    if ((unsigned)(x + TETRIS_WALL) > 16 - 4 || y < -TETRIS_PAD || y > TETRIS_ROWS)
+        return false;
+    // the four rows gathered into one word, tested as tetris_fits() does
+    const uint16_t *rows = &b->rows[(TETRIS_PAD + y) * b->stride + k];
+    const size_t n = b->stride;
+    uint64_t field = rows[0] | (uint64_t)rows[n] << 16 | (uint64_t)rows[2 * n] << 32 | (uint64_t)rows[3 * n] << 48;
+    return (field & PIECE.shifted[(t * 4 + r) * 16 + x + 4]) == 0;
+}
+
+// (ct, cr, cx, cy)[j] of game lane[j] -> fit[j]
+static void fits_scalar(TetrisBatch *b, int m)
+{
+    for (int j = 0; j < m; j++)
+        b->fit[j] = fits_lane(b, b->lane[j], b->ct[j], b->cr[j], b->cx[j], b->cy[j]);
+}
+
+#if TETRIS_BATCH_X86
+AVX2 static inline __m256i load8(const int8_t *p)
+{
+    return _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)p));
+}
+
+// low byte of each 32-bit lane
+AVX2 static inline void store8(void *p, __m256i v)
+{
+    const __m256i low = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, //
+                                         0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    v = _mm256_shuffle_epi8(v, low);
+    uint32_t lo = _mm256_extract_epi32(v, 0), hi = _mm256_extract_epi32(v, 4);
+    memcpy(p, &lo, 4);
+    memcpy((uint8_t *)p + 4, &hi, 4);
+}
+
+// all ones in the lanes of games k where piece (t, r) fits at (x, y)
+AVX2 static inline __m256i collide8(const TetrisBatch *b, __m256i k, __m256i t, __m256i r, __m256i x, __m256i y)
+{
+    const __m256i stride = _mm256_set1_epi32(b->stride);
+    const int *rows = (const int *)b->rows;
+    const int *piece = (const int *)PIECE.rows;
+
+    __m256i shift = _mm256_add_epi32(x, _mm256_set1_epi32(TETRIS_WALL));
+    __m256i off = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), shift),
+                        _mm256_cmpgt_epi32(shift, _mm256_set1_epi32(16 - 4))),
+        _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(-TETRIS_PAD), y),
+                        _mm256_cmpgt_epi32(y, _mm256_set1_epi32(TETRIS_ROWS))));
+    // lanes off the field read row 0 with no shift and are rejected below
+    shift = _mm256_andnot_si256(off, shift);
+    y = _mm256_andnot_si256(off, y);
+
+    __m256i row = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(y, _mm256_set1_epi32(TETRIS_PAD)), stride), k);
+    __m256i pidx = _mm256_slli_epi32(_mm256_add_epi32(_mm256_slli_epi32(t, 2), r), 2);
+    __m256i hit = _mm256_setzero_si256();
+    for (int i = 0; i < 4; i++)
+    {
+        __m256i board = _mm256_and_si256(_mm256_i32gather_epi32(rows, row, 2), _mm256_set1_epi32(0xFFFF));
+        __m256i mask = _mm256_sllv_epi32(_mm256_i32gather_epi32(piece, pidx, 4), shift);
+        hit = _mm256_or_si256(hit, _mm256_and_si256(board, mask));
+        row = _mm256_add_epi32(row, stride);
+        pidx = _mm256_add_epi32(pidx, _mm256_set1_epi32(1));
+    }
+    return _mm256_andnot_si256(off, _mm256_cmpeq_epi32(hit, _mm256_setzero_si256()));
+}
+
+AVX2 static void fits_avx2(TetrisBatch *b, int m)
+{
+    // the list is padded to whole vectors by fits()
+    for (int j = 0; j < m; j += 8)
+    {
+        __m256i k = _mm256_load_si256((const __m256i *)&b->lane[j]);
+        __m256i ok = collide8(b, k, load8(&b->ct[j]), load8(&b->cr[j]), load8(&b->cx[j]), load8(&b->cy[j]));
+        store8(&b->fit[j], _mm256_srli_epi32(ok, 31));
+    }
+}
+
+// AVX2 kernels take whole vectors; the list is padded with repeats of its
+// last entry
+static void pad_list(TetrisBatch *b, int *m)
+{
+    for (; *m & 7; ++*m)
+    {
+        int j = *m;
+        b->lane[j] = b->lane[j - 1];
+        b->ct[j] = b->ct[j - 1];
+        b->cr[j] = b->cr[j - 1];
+        b->cx[j] = b->cx[j - 1];
+        b->cy[j] = b->cy[j - 1];
+    }
+}
+#endif
+
+static void fits(TetrisBatch *b, int m)
+{
+#if TETRIS_BATCH_X86
+    if (b->kernel == TETRIS_KERNEL_AVX2)
+    {
+        pad_list(b, &m);
+        return fits_avx2(b, m);
+    }
+#endif
+    fits_scalar(b, m);
+}
+
+// ---- hard drop distance from the column tops as in tetris_drop_distance(),
+// or TUCKED when a mino is under its column's top and stepping has to tell
+
+#define TUCKED 0xFF
+
+// Rows piece t can fall from (r, x, y) in game k
+static inline int drop_lane(const TetrisBatch *b, int k, int t, int r, int x, int y)
+{
+    const int8_t *bottom = TETRIS_TABLES.bottom[t][r];
+    int drop = TETRIS_ROWS + TETRIS_PAD;
+    bool tucked = false;
+    for (int xx = 0; xx < 4; xx++)
+    {
+        // empty box columns may be off the field; they read column 0
+        bool used = bottom[xx] >= 0;
+        int d = b->top[(used ? x + xx : 0) * b->stride + k] - (y + bottom[xx]) - 1;
+        tucked |= used && d < 0;
+        drop = (used && d < drop) ? d : drop;
+    }
+    return tucked ? TUCKED : drop;
+}
+
+#if TETRIS_BATCH_X86
+// fit[j] = drop_lane() of game lane[j] from cy[j] - 1
+AVX2 static void drops_avx2(TetrisBatch *b, int m)
+{
+    const __m256i stride = _mm256_set1_epi32(b->stride);
+    const int *top = (const int *)b->top;
+    for (int j = 0; j < m; j += 8)
+    {
+        __m256i k = _mm256_load_si256((const __m256i *)&b->lane[j]);
+        __m256i x = load8(&b->cx[j]);
+        __m256i y = _mm256_sub_epi32(load8(&b->cy[j]), _mm256_set1_epi32(1));
+        __m256i bidx = _mm256_slli_epi32(_mm256_add_epi32(_mm256_slli_epi32(load8(&b->ct[j]), 2), load8(&b->cr[j])), 2);
+        __m256i drop = _mm256_set1_epi32(TETRIS_ROWS + TETRIS_PAD);
+        __m256i tucked = _mm256_setzero_si256();
+        for (int xx = 0; xx < 4; xx++)
+        {
+            __m256i bottom = _mm256_i32gather_epi32(PIECE.bottom, _mm256_add_epi32(bidx, _mm256_set1_epi32(xx)), 4);
+            __m256i used = _mm256_cmpgt_epi32(bottom, _mm256_set1_epi32(-1));
+            // empty box columns may be off the field; they read column 0
+            __m256i col = _mm256_and_si256(used, _mm256_add_epi32(x, _mm256_set1_epi32(xx)));
+            __m256i t = _mm256_i32gather_epi32(top, _mm256_add_epi32(_mm256_mullo_epi32(col, stride), k), 1);
+            __m256i d = _mm256_sub_epi32(_mm256_and_si256(t, _mm256_set1_epi32(0xFF)),
+                                         _mm256_add_epi32(_mm256_add_epi32(y, bottom), _mm256_set1_epi32(1)));
+            tucked = _mm256_or_si256(tucked, _mm256_and_si256(used, _mm256_cmpgt_epi32(_mm256_setzero_si256(), d)));
+            drop = _mm256_blendv_epi8(drop, _mm256_min_epi32(drop, d), used);
+        }
+        store8(&b->fit[j], _mm256_or_si256(drop, tucked));
+    }
+}
+#endif
+
+// ---- full rows after locking -> full[game] (bit r = field row r)
+
+// only the four rows of the piece's box can have filled up
+static void full_lane(TetrisBatch *b, int k)
+{
+    const int y = b->y[k];
+    const uint16_t *rows = &b->rows[(TETRIS_PAD + y) * b->stride + k];
+    uint32_t full = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        // the rows past the field are full too
+        bool hit = rows[i * b->stride] == TETRIS_FULL_ROW && (unsigned)(y + i) < TETRIS_ROWS;
+        full |= (uint32_t)hit << ((y + i) & 31);
+    }
+    b->full[k] = full;
+}
+
+#if TETRIS_BATCH_X86
+// movemask gives two bits per 16-bit lane; full rows are rare, so the
+// per-game loop only runs for a hit
+static inline void mark_full(TetrisBatch *b, int k, unsigned bits, int r)
+{
+    for (; bits; bits &= bits - 1)
+        b->full[k + __builtin_ctz(bits) / 2] |= 1u << r;
+}
+
+__attribute__((target("sse2"))) static void full_sse2(TetrisBatch *b)
+{
+    const __m128i ones = _mm_set1_epi16(-1);
+    memset(b->full, 0, b->count * sizeof(b->full[0]));
+    for (int r = 0; r < TETRIS_ROWS; r++)
+    {
+        const uint16_t *row = &b->rows[(TETRIS_PAD + r) * b->stride];
+        for (int k = 0; k < b->count; k += 8)
+        {
+            __m128i v = _mm_load_si128((const __m128i *)&row[k]);
+            unsigned bits = _mm_movemask_epi8(_mm_cmpeq_epi16(v, ones)) & 0x5555;
+            if (bits)
+                mark_full(b, k, bits, r);
+        }
+    }
+}
+
+AVX2 static void full_avx2(TetrisBatch *b)
+{
+    const __m256i ones = _mm256_set1_epi16(-1);
+    memset(b->full, 0, b->count * sizeof(b->full[0]));
+    for (int r = 0; r < TETRIS_ROWS; r++)
+    {
+        const uint16_t *row = &b->rows[(TETRIS_PAD + r) * b->stride];
+        for (int k = 0; k < b->count; k += 16)
+        {
+            __m256i v = _mm256_load_si256((const __m256i *)&row[k]);
+            unsigned bits = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi16(v, ones)) & 0x55555555u;
+            if (bits)
+                mark_full(b, k, bits, r);
+        }
+    }
+}
+#endif
+
+// When most games locked this step a vector scan of every row of every
+// game beats four strided loads per game; otherwise only the locked ones
+// are looked at
+static void full_rows(TetrisBatch *b, int locks)
+{
+#if TETRIS_BATCH_X86
+    if (locks * 4 >= b->count && b->kernel == TETRIS_KERNEL_AVX2)
+        return full_avx2(b);
+    if (locks * 4 >= b->count && b->kernel == TETRIS_KERNEL_SSE2)
+        return full_sse2(b);
+#endif
+    for (int j = 0; j < locks; j++)
+        full_lane(b, b->locked[j]);
+}
+
+// ---- per-game rules
+
+static void clear_board(TetrisBatch *b, int k)
+{
+    for (int i = 0; i < TETRIS_BATCH_ROWS; i++)
+        b->rows[i * b->stride + k] = (i < TETRIS_PAD + TETRIS_ROWS) ? TETRIS_WALL_MASK : TETRIS_FULL_ROW;
+    for (int c = 0; c < TETRIS_COLS; c++)
+        b->top[c * b->stride + k] = TETRIS_ROWS;
+}
+
+// tetris_update_tops() for game k
+static void update_tops(TetrisBatch *b, int k)
+{
+    uint16_t seen = TETRIS_WALL_MASK;
+    for (int c = 0; c < TETRIS_COLS; c++)
+        b->top[c * b->stride + k] = TETRIS_ROWS;
+    for (int r = 0; r < TETRIS_ROWS && seen != TETRIS_FULL_ROW; r++)
+    {
+        uint16_t fresh = b->rows[(TETRIS_PAD + r) * b->stride + k] & ~seen;
+        seen |= fresh;
+        for (; fresh; fresh &= fresh - 1)
+            b->top[(__builtin_ctz(fresh) - TETRIS_WALL) * b->stride + k] = r;
+    }
+}
+
+// tetris_bag_deal() on game k's bag
+static int deal(TetrisBatch *b, int k)
+{
+    uint8_t *bag = &b->bag[k * TETRIS_PIECES];
+    if (b->bag_next[k] >= TETRIS_PIECES)
+    {
+        for (int i = 0; i < TETRIS_PIECES; i++)
+            bag[i] = i;
+        for (int i = TETRIS_PIECES - 1; i > 0; i--)
+        {
+            int j = tetris_xorshift32(&b->rng[k]) % (i + 1);
+            uint8_t tmp = bag[i];
+            bag[i] = bag[j];
+            bag[j] = tmp;
+        }
+        b->bag_next[k] = 0;
+    }
+    return bag[b->bag_next[k]++];
+}
+
+static void spawn(TetrisBatch *b, int k)
+{
+    int t = deal(b, k);
+    b->t[k] = t;
+    b->r[k] = 0;
+    b->x[k] = TETRIS_TABLES.spawn_x[t];
+    b->y[k] = 0;
+    if (b->rows[TETRIS_PAD * b->stride + k] != TETRIS_WALL_MASK)
+    {
+        b->top_outs[k]++;
+        b->score[k] = 0;
+        b->lines[k] = 0;
+        clear_board(b, k);
+    }
+}
+
+static void lock(TetrisBatch *b, int k)
+{
+    // locals throughout: the byte stores to top[] may alias anything
+    const int t = b->t[k], r = b->r[k], x = b->x[k], y = b->y[k];
+    const size_t stride = b->stride;
+    uint16_t *rows = &b->rows[TETRIS_PAD * stride + k];
+    uint8_t *top = &b->top[k];
+    // no branches on the piece's shape, which the predictor cannot learn
+    // across games: rows below the field are full already, and the cells
+    // above it are masked off
+    uint64_t piece = TETRIS_TABLES.rows[t][r] << (x + TETRIS_WALL);
+    for (int i = 0; i < 4; i++)
+    {
+        uint16_t mask = (y + i >= 0) ? (uint16_t)(piece >> (16 * i)) : 0;
+        rows[(y + i) * stride] |= mask;
+    }
+    const uint8_t *cells = TETRIS_TABLES.cells[t][r];
+    for (int i = 0; i < 4; i++)
+    {
+        int row = y + (cells[i] >> 2), col = x + (cells[i] & 3);
+        uint8_t *c = &top[col * stride];
+        int v = *c;
+        *c = (uint8_t)((row >= 0 && row < v) ? row : v);
+    }
+    b->pieces[k]++;
+}
+
+static void clear_lines(TetrisBatch *b, int k)
+{
+    static const int pts[5] = {0, 40, 100, 300, 1200};
+    uint32_t full = b->full[k];
+    int n = __builtin_popcount(full);
+    int dst = TETRIS_ROWS - 1;
+    for (int src = TETRIS_ROWS - 1; src >= 0; src--)
+    {
+        if (full & (1u << src))
+            continue;
+        b->rows[(TETRIS_PAD + dst) * b->stride + k] = b->rows[(TETRIS_PAD + src) * b->stride + k];
+        dst--;
+    }
+    for (; dst >= 0; dst--)
+        b->rows[(TETRIS_PAD + dst) * b->stride + k] = TETRIS_WALL_MASK;
+    update_tops(b, k);
+
+    b->score[k] += pts[n] * (1 + b->lines[k] / 10);
+    b->lines[k] += n;
+}
+
+// ---- stepping
+
+static inline void add(TetrisBatch *b, int j, int k, int r, int x, int y)
+{
+    b->lane[j] = k;
+    b->ct[j] = b->t[k];
+    b->cr[j] = r;
+    b->cx[j] = x;
+    b->cy[j] = y;
+}
+
+// candidate j becomes the position of its game
+static inline void take(TetrisBatch *b, int j)
+{
+    int k = b->lane[j];
+    b->r[k] = b->cr[j];
+    b->x[k] = b->cx[j];
+    b->y[k] = b->cy[j];
+}
+
+// candidate j moves up the list to entry next
+static inline void keep(TetrisBatch *b, int next, int j)
+{
+    b->lane[next] = b->lane[j];
+    b->ct[next] = b->ct[j];
+    b->cr[next] = b->cr[j];
+    b->cx[next] = b->cx[j];
+    b->cy[next] = b->cy[j];
+}
+
+// ... and is tried one row lower
+static inline void fall(TetrisBatch *b, int next, int j)
+{
+    keep(b, next, j);
+    b->cy[next]++;
+}
+
+#if TETRIS_BATCH_X86
+// First test of every game's action: the move itself, or kick 0 (no
+// offset) of a turn. Three passes over all games: the candidate positions
+// into cr/cx/cy[game], the collision tests into fit[game], then the
+// updates and the lists of the games still in play. Actions are random from
+// one game to the next, so nothing branches on them; the first and last
+// pass run in vectors, and the tests are the one gather left, tight enough
+// to stay in registers.
+
+// Candidates start from a position that fits, so they never leave the
+// padded rows, and PIECE.shifted fails them off the sides
+static void tests_first(TetrisBatch *b)
+{
+    const int count = b->count;
+    const size_t n = b->stride;
+    const uint16_t *rows = &b->rows[TETRIS_PAD * n];
+    const int8_t *t = b->t, *r = b->cr, *x = b->cx, *y = b->cy;
+    uint8_t *fit = b->fit;
+    for (int k = 0; k < count; k++)
+    {
+        const uint16_t *p = &rows[y[k] * n + k];
+        uint64_t field = p[0] | (uint64_t)p[n] << 16 | (uint64_t)p[2 * n] << 32 | (uint64_t)p[3 * n] << 48;
+        fit[k] = (field & PIECE.shifted[(t[k] * 4 + r[k]) * 16 + x[k] + 4]) == 0;
+    }
+}
+
+// Game k's hard drop fell its first row: straight down to the column tops,
+// or listed to step down when tucked under an overhang
+static inline void hard_drop(TetrisBatch *b, StepLists *out, int k)
+{
+    int d = drop_lane(b, k, b->t[k], b->r[k], b->x[k], b->y[k]);
+    if (d == TUCKED)
+        add(b, out->falls++, k, b->r[k], b->x[k], b->y[k] + 1);
+    else
+    {
+        b->y[k] += d;
+        b->score[k] += 2 * d;
+    }
+}
+
+// v[0..16) = c[] where mask is set
+SSE2 static inline void blend_sse2(int8_t *v, const int8_t *c, __m128i mask)
+{
+    __m128i old = _mm_load_si128((const __m128i *)v), cand = _mm_load_si128((const __m128i *)c);
+    _mm_store_si128((__m128i *)v, _mm_or_si128(_mm_and_si128(mask, cand), _mm_andnot_si128(mask, old)));
+}
+
+// 16 games at a time, in bytes
+SSE2 static void first_try_sse2(TetrisBatch *b, const uint8_t *actions, StepLists *out)
+{
+    const __m128i zero = _mm_setzero_si128(), three = _mm_set1_epi8(3);
+    for (int k = 0; k < b->count; k += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)&actions[k]);
+        // masks are -1: r - cw + 3 * ccw, x - right + left, y - (down | drop)
+        __m128i cw = _mm_cmpeq_epi8(a, _mm_set1_epi8(TETRIS_ACT_CW));
+        __m128i ccw = _mm_cmpeq_epi8(a, _mm_set1_epi8(TETRIS_ACT_CCW));
+        __m128i left = _mm_cmpeq_epi8(a, _mm_set1_epi8(TETRIS_ACT_LEFT));
+        __m128i right = _mm_cmpeq_epi8(a, _mm_set1_epi8(TETRIS_ACT_RIGHT));
+        __m128i fall = _mm_or_si128(_mm_cmpeq_epi8(a, _mm_set1_epi8(TETRIS_ACT_DOWN)),
+                                    _mm_cmpeq_epi8(a, _mm_set1_epi8(TETRIS_ACT_DROP)));
+        __m128i r = _mm_load_si128((const __m128i *)&b->r[k]);
+        __m128i x = _mm_load_si128((const __m128i *)&b->x[k]);
+        __m128i y = _mm_load_si128((const __m128i *)&b->y[k]);
+        r = _mm_and_si128(_mm_add_epi8(_mm_sub_epi8(r, cw), _mm_and_si128(ccw, three)), three);
+        _mm_store_si128((__m128i *)&b->cr[k], r);
+        _mm_store_si128((__m128i *)&b->cx[k], _mm_add_epi8(_mm_sub_epi8(x, right), left));
+        _mm_store_si128((__m128i *)&b->cy[k], _mm_sub_epi8(y, fall));
+    }
+
+    tests_first(b);
+
+    int falls = 0;
+    for (int k = 0; k < b->count; k += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)&actions[k]);
+        __m128i turn = _mm_or_si128(_mm_cmpeq_epi8(a, _mm_set1_epi8(TETRIS_ACT_CW)),
+                                    _mm_cmpeq_epi8(a, _mm_set1_epi8(TETRIS_ACT_CCW)));
+        __m128i down = _mm_cmpeq_epi8(a, _mm_set1_epi8(TETRIS_ACT_DOWN));
+        __m128i drop = _mm_cmpeq_epi8(a, _mm_set1_epi8(TETRIS_ACT_DROP));
+        __m128i ok = _mm_sub_epi8(zero, _mm_load_si128((const __m128i *)&b->fit[k]));
+        blend_sse2(&b->r[k], &b->cr[k], ok);
+        blend_sse2(&b->x[k], &b->cx[k], ok);
+        blend_sse2(&b->y[k], &b->cy[k], ok);
+
+        // a soft drop row scores 1, a hard drop row 2
+        __m128i points = _mm_and_si128(ok, _mm_or_si128(_mm_and_si128(down, _mm_set1_epi8(1)),
+                                                        _mm_and_si128(drop, _mm_set1_epi8(2))));
+        __m128i lo = _mm_unpacklo_epi8(points, zero), hi = _mm_unpackhi_epi8(points, zero);
+        __m128i *score = (__m128i *)&b->score[k];
+        _mm_store_si128(&score[0], _mm_add_epi32(_mm_load_si128(&score[0]), _mm_unpacklo_epi16(lo, zero)));
+        _mm_store_si128(&score[1], _mm_add_epi32(_mm_load_si128(&score[1]), _mm_unpackhi_epi16(lo, zero)));
+        _mm_store_si128(&score[2], _mm_add_epi32(_mm_load_si128(&score[2]), _mm_unpacklo_epi16(hi, zero)));
+        _mm_store_si128(&score[3], _mm_add_epi32(_mm_load_si128(&score[3]), _mm_unpackhi_epi16(hi, zero)));
+
+        unsigned drops = _mm_movemask_epi8(_mm_and_si128(ok, drop));
+        unsigned turns = _mm_movemask_epi8(_mm_andnot_si128(ok, turn));
+        unsigned locks = _mm_movemask_epi8(_mm_or_si128(drop, _mm_andnot_si128(ok, down)));
+        for (; drops; drops &= drops - 1)
+            b->lane[falls++] = k + __builtin_ctz(drops);
+        for (; turns; turns &= turns - 1)
+            b->turn[out->turns++] = k + __builtin_ctz(turns);
+        for (; locks; locks &= locks - 1)
+            b->locked[out->locks++] = k + __builtin_ctz(locks);
+    }
+
+    for (int j = 0; j < falls; j++)
+        hard_drop(b, out, b->lane[j]);
+}
+#endif
+
+#if TETRIS_BATCH_X86
+// The same with every game in a lane: candidates, test and update are
+// branch-free over 8 games at a time, and only the games left in play
+// (falling, blocked turn, locking) are picked out of the masks into lists
+AVX2 static void first_try_avx2(TetrisBatch *b, const uint8_t *actions, StepLists *out)
+{
+    const __m256i iota = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for (int k = 0; k < b->count; k += 8)
+    {
+        __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&actions[k]));
+        __m256i left = _mm256_cmpeq_epi32(a, _mm256_set1_epi32(TETRIS_ACT_LEFT));
+        __m256i right = _mm256_cmpeq_epi32(a, _mm256_set1_epi32(TETRIS_ACT_RIGHT));
+        __m256i cw = _mm256_cmpeq_epi32(a, _mm256_set1_epi32(TETRIS_ACT_CW));
+        __m256i ccw = _mm256_cmpeq_epi32(a, _mm256_set1_epi32(TETRIS_ACT_CCW));
+        __m256i down = _mm256_cmpeq_epi32(a, _mm256_set1_epi32(TETRIS_ACT_DOWN));
+        __m256i drop = _mm256_cmpeq_epi32(a, _mm256_set1_epi32(TETRIS_ACT_DROP));
+        __m256i none = _mm256_cmpeq_epi32(a, _mm256_setzero_si256());
+
+        __m256i t = load8(&b->t[k]), r = load8(&b->r[k]), x = load8(&b->x[k]), y = load8(&b->y[k]);
+        // masks are -1: x - left + right, r - cw + 3 * ccw, y - (down | drop)
+        __m256i cx = _mm256_sub_epi32(_mm256_add_epi32(x, left), right);
+        __m256i cr = _mm256_and_si256(
+            _mm256_add_epi32(_mm256_sub_epi32(r, cw), _mm256_and_si256(ccw, _mm256_set1_epi32(3))),
+            _mm256_set1_epi32(3));
+        __m256i cy = _mm256_sub_epi32(y, _mm256_or_si256(down, drop));
+
+        __m256i fit = collide8(b, _mm256_add_epi32(iota, _mm256_set1_epi32(k)), t, cr, cx, cy);
+        __m256i moved = _mm256_andnot_si256(none, fit);
+        store8(&b->r[k], _mm256_blendv_epi8(r, cr, moved));
+        store8(&b->x[k], _mm256_blendv_epi8(x, cx, moved));
+        store8(&b->y[k], _mm256_blendv_epi8(y, cy, moved));
+
+        // a soft drop row scores 1, a hard drop row 2
+        __m256i points = _mm256_and_si256(moved, _mm256_sub_epi32(_mm256_setzero_si256(),
+                                                                  _mm256_add_epi32(down, _mm256_add_epi32(drop, drop))));
+        __m256i *score = (__m256i *)&b->score[k];
+        _mm256_store_si256(score, _mm256_add_epi32(_mm256_load_si256(score), points));
+
+        unsigned falls = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(moved, drop)));
+        unsigned turns = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_andnot_si256(fit, _mm256_or_si256(cw, ccw))));
+        unsigned locks = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(drop, _mm256_andnot_si256(fit, down))));
+        for (; falls; falls &= falls - 1)
+        {
+            int g = k + __builtin_ctz(falls);
+            add(b, out->falls++, g, b->r[g], b->x[g], b->y[g] + 1);
+        }
+        for (; turns; turns &= turns - 1)
+            b->turn[out->turns++] = k + __builtin_ctz(turns);
+        for (; locks; locks &= locks - 1)
+            b->locked[out->locks++] = k + __builtin_ctz(locks);
+    }
+
+    // hard drops straight down to the column tops; only the tucked ones
+    // stay listed
+    int n = out->falls, m = n;
+    out->falls = 0;
+    pad_list(b, &m);
+    drops_avx2(b, m);
+    for (int j = 0; j < n; j++)
+    {
+        int k = b->lane[j], d = b->fit[j];
+        if (d == TUCKED)
+            keep(b, out->falls++, j);
+        else
+        {
+            b->y[k] += d;
+            b->score[k] += 2 * d;
+        }
+    }
+}
+#endif
+
+// Every round after the first tests only the games still in play (pieces
+// still falling, turns waiting for their next kick), listed in lane[] and
+// packed to the front
+void tetris_batch_step(TetrisBatch *b, const uint8_t *actions)
+{
+    // the kernels read whole vectors of actions; the padding games get
+    // TETRIS_ACT_NONE from act[]
+    if (b->games < b->count)
+    {
+        memcpy(b->act, actions, b->games);
+        actions = b->act;
+    }
+
+    StepLists in_play = {0, 0, 0};
+#if TETRIS_BATCH_X86
+    if (b->kernel == TETRIS_KERNEL_AVX2)
+        first_try_avx2(b, actions, &in_play);
+    else
+        first_try_sse2(b, actions, &in_play);
+#endif
+
+    // hard drops of pieces tucked under an overhang: one row per round,
+    // together
+    int m, next = in_play.falls;
+    for (m = next; m; m = next)
+    {
+        fits(b, m);
+        next = 0;
+        for (int j = 0; j < m; j++)
+        {
+            if (!b->fit[j])
+                continue;
+            int k = b->lane[j];
+            b->y[k]++;
+            b->score[k] += 2;
+            fall(b, next++, j);
+        }
+    }
+
+    // remaining SRS kicks, one round per test for the turns still blocked
+    int turns = in_play.turns;
+    for (int i = 1; turns && i < TETRIS_KICK_TESTS; i++)
+    {
+        m = 0;
+        for (int j = 0; j < turns; j++)
+        {
+            int k = b->turn[j];
+            int set = TETRIS_TABLES.kick_set[b->t[k]];
+            if (i >= TETRIS_TABLES.kick_tests[set])
+                continue;
+            int ccw = actions[k] == TETRIS_ACT_CCW;
+            const int8_t *d = TETRIS_TABLES.kicks[set][b->r[k]][ccw][i];
+            add(b, m++, k, (b->r[k] + (ccw ? 3 : 1)) & 3, b->x[k] + d[0], b->y[k] + d[1]);
+        }
+        if (!m)
+            break;
+        fits(b, m);
+        turns = 0;
+        for (int j = 0; j < m; j++)
+        {
+            if (b->fit[j])
+                take(b, j);
+            else
+                b->turn[turns++] = b->lane[j];
+        }
+    }
+
+    const int locks = in_play.locks;
+    if (!locks)
+        return;
+    for (int j = 0; j < locks; j++)
+        lock(b, b->locked[j]);
+    full_rows(b, locks);
+    for (int j = 0; j < locks; j++)
+    {
+        int k = b->locked[j];
+        if (b->full[k])
+            clear_lines(b, k);
+        spawn(b, k);
+    }
+}
+
+// ---- setup
+
+const char *tetris_batch_kernel_name(TetrisKernel kernel)
+{
+    switch (kernel)
+    {
+    case TETRIS_KERNEL_SSE2: return "sse2";
+    case TETRIS_KERNEL_AVX2: return "avx2";
+    default: return "auto";
+    }
+}
+
+bool tetris_batch_kernel_supported(TetrisKernel kernel)
+{
+    switch (kernel)
+    {
+#if TETRIS_BATCH_X86
+    case TETRIS_KERNEL_AUTO: return true;
+    case TETRIS_KERNEL_SSE2: return __builtin_cpu_supports("sse2");
+    case TETRIS_KERNEL_AVX2: return __builtin_cpu_supports("avx2");
+#endif
+    default: return false;
+    }
+}
+
+bool tetris_batch_init(TetrisBatch *b, int count, uint32_t seed, const uint32_t *seeds, TetrisKernel kernel)
+{
+    memset(b, 0, sizeof(*b));
+    if (kernel == TETRIS_KERNEL_AUTO)
+    {
+        kernel = tetris_batch_kernel_supported(TETRIS_KERNEL_AVX2) ? TETRIS_KERNEL_AVX2 : TETRIS_KERNEL_SSE2;
+    }
+    if (!tetris_batch_kernel_supported(kernel) || count <= 0)
+        return false;
+
+    const int n = (count + TETRIS_BATCH_LANES - 1) / TETRIS_BATCH_LANES * TETRIS_BATCH_LANES;
+    b->games = count;
+    b->count = n;
+    // an odd multiple of 64 lanes: a power-of-two stride would put all rows
+    // and column tops of a game in one cache set
+    b->stride = ((n + 63) & ~63) | 64;
+    b->kernel = kernel;
+    b->rows = (uint16_t *)alloc_lanes(TETRIS_BATCH_ROWS * b->stride * sizeof(uint16_t));
+    b->t = (int8_t *)alloc_lanes(n);
+    b->r = (int8_t *)alloc_lanes(n);
+    b->x = (int8_t *)alloc_lanes(n);
+    b->y = (int8_t *)alloc_lanes(n);
+    b->rng = (uint32_t *)alloc_lanes(n * sizeof(uint32_t));
+    b->bag = (uint8_t *)alloc_lanes(n * TETRIS_PIECES);
+    b->bag_next = (uint8_t *)alloc_lanes(n);
+    b->score = (int32_t *)alloc_lanes(n * sizeof(int32_t));
+    b->lines = (int32_t *)alloc_lanes(n * sizeof(int32_t));
+    b->pieces = (uint32_t *)alloc_lanes(n * sizeof(uint32_t));
+    b->top_outs = (uint32_t *)alloc_lanes(n * sizeof(uint32_t));
+    b->lane = (int32_t *)alloc_lanes(n * sizeof(int32_t));
+    b->ct = (int8_t *)alloc_lanes(n);
+    b->cr = (int8_t *)alloc_lanes(n);
+    b->cx = (int8_t *)alloc_lanes(n);
+    b->cy = (int8_t *)alloc_lanes(n);
+    b->fit = (uint8_t *)alloc_lanes(n);
+    b->turn = (int32_t *)alloc_lanes(n * sizeof(int32_t));
+    b->locked = (int32_t *)alloc_lanes(n * sizeof(int32_t));
+    b->full = (uint32_t *)alloc_lanes(n * sizeof(uint32_t));
+    b->top = (uint8_t *)alloc_lanes(TETRIS_COLS * b->stride);
+    b->act = (uint8_t *)alloc_lanes(n);
+    if (!b->rows || !b->t || !b->r || !b->x || !b->y || !b->rng || !b->bag || !b->bag_next || !b->score ||
+        !b->lines || !b->pieces || !b->top_outs || !b->lane || !b->ct || !b->cr || !b->cx || !b->cy || !b->fit ||
+        !b->turn || !b->locked || !b->full || !b->top || !b->act)
+    {
+        tetris_batch_free(b);
+        return false;
+    }
+
+    for (int k = 0; k < n; k++)
+    {
+        // padding games past the ones asked for stand still
+        uint32_t s = seeds && k < count ? seeds[k] : seed + (uint32_t)k;
+        b->rng[k] = s ? s : 1;
+        b->bag_next[k] = TETRIS_PIECES;
+        clear_board(b, k);
+        spawn(b, k);
+    }
+    return true;
+}
+
+void tetris_batch_free(TetrisBatch *b)
+{
+    void *arrays[] = {b->rows,   b->t,        b->r,    b->x,  b->y,  b->rng, b->bag,
+                      b->bag_next, b->score,  b->lines, b->pieces, b->top_outs, b->lane, b->ct,
+                      b->cr,     b->cx,       b->cy,   b->fit, b->turn, b->locked, b->full,
+                      b->top,    b->act};
+    for (void *p : arrays)
+        free(p);
+    memset(b, 0, sizeof(*b));
+}
@@ -0,0 +1,98 @@
+#ifndef TETRIS_BATCH_H_
+#define TETRIS_BATCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tetris_board.h"
+
+// Many boards stepped together, for bulk evaluation on the host (not part
+// of the firmware). State is kept structure-of-arrays: board row r of all
+// games is one contiguous run of uint16_t row masks (same encoding as
+// TetrisBoard.rows), and piece, bag and score fields are one array each.
+// That lets the collision test of every game's next position, hard drop
+// distances from the column tops and the full-row scan after locking run
+// across games in SIMD lanes: AVX2 (8 games per gather, 16 row compares per
+// instruction) or SSE2 (16 games' moves per instruction, 8 row compares),
+// chosen at run time. There is no scalar kernel: stepped one at a time the
+// games are faster on their own TetrisBoards, so off x86 tetris_batch_init()
+// fails and callers do that.
+//
+// The game is turn-based here: one action per step and game, no clock, no
+// lock delay, no hold. Rotation uses the SRS kicks; pieces come from each
+// game's own 7-bag; line clears score and level up as in tetris_game.cpp,
+// and a game that tops out starts again on an empty board.
+
+enum
+{
+    TETRIS_ACT_NONE,
+    TETRIS_ACT_LEFT,
+    TETRIS_ACT_RIGHT,
+    TETRIS_ACT_CW,
+    TETRIS_ACT_CCW,
+    TETRIS_ACT_DOWN, // one row, locks when it cannot
+    TETRIS_ACT_DROP, // hard drop and lock
+    TETRIS_ACTIONS
+};
+
+typedef enum
+{
+    TETRIS_KERNEL_AUTO,
+    TETRIS_KERNEL_SSE2,
+    TETRIS_KERNEL_AVX2,
+} TetrisKernel;
+
+#define TETRIS_BATCH_LANES 16 // game count granularity
+#define TETRIS_BATCH_ROWS (TETRIS_PAD + TETRIS_ROWS + TETRIS_PAD)
+
+typedef struct
+{
+    int games;  // as asked for
+    int count;  // games rounded up to TETRIS_BATCH_LANES; the rest are padding
+    int stride; // lanes from one row (or column) to the next, >= count
+    TetrisKernel kernel;
+
+    uint16_t *rows; // [TETRIS_BATCH_ROWS][stride]
+    uint8_t *top;   // [TETRIS_COLS][stride], as TetrisBoard.top
+
+    // current piece
+    int8_t *t, *r, *x, *y;
+
+    // 7-bag randomizer
+    uint32_t *rng;
+    uint8_t *bag; // [count][TETRIS_PIECES]
+    uint8_t *bag_next;
+
+    int32_t *score;
+    int32_t *lines;
+    uint32_t *pieces;
+    uint32_t *top_outs;
+
+    // per-step scratch: the games to test, their candidate positions and
+    // the test results, packed in list order
+    int32_t *lane;
+    int8_t *ct, *cr, *cx, *cy;
+    uint8_t *fit;
+    int32_t *turn;   // games whose turn is still blocked
+    int32_t *locked; // games locking this step
+    uint32_t *full;
+    uint8_t *act; // [count] the actions stepped, TETRIS_ACT_NONE for padding
+} TetrisBatch;
+
+// count is rounded up to TETRIS_BATCH_LANES; game i is seeded with seeds[i]
+// (or seed + i when seeds is NULL). Returns false when out of memory or the
+// kernel is not supported by this CPU.
+bool tetris_batch_init(TetrisBatch *b, int count, uint32_t seed, const uint32_t *seeds, TetrisKernel kernel);
+void tetris_batch_free(TetrisBatch *b);
+
+// One TETRIS_ACT_* for each of the b->games games; padding games stand still
+void tetris_batch_step(TetrisBatch *b, const uint8_t *actions);
+
+static inline uint16_t tetris_batch_row(const TetrisBatch *b, int game, int r)
+{
+    return b->rows[(TETRIS_PAD + r) * b->stride + game];
+}
+
+const char *tetris_batch_kernel_name(TetrisKernel kernel);
+bool tetris_batch_kernel_supported(TetrisKernel kernel);
+
+#endif
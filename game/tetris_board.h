@@ -0,0 +1,170 @@
+#ifndef TETRIS_BOARD_H_
+#define TETRIS_BOARD_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "tetris_pieces.h"
+
+// Playfield as one occupancy mask per row plus a separate color plane.
+// Column c is bit c + TETRIS_WALL of its row; the bits either side are set
+// as walls, and padding rows above (walls only) and below (solid floor) keep
+// every position a piece box can reach inside the array. A collision test is
+// then a 64-bit load of four rows, one shift and one AND.
+
+#define TETRIS_COLS 10
+#define TETRIS_ROWS 21 // 20 visible + 1 hidden above
+
+#define TETRIS_WALL 3
+#define TETRIS_WALL_MASK ((uint16_t)(0xFFFFu & ~(((1u << TETRIS_COLS) - 1) << TETRIS_WALL)))
+#define TETRIS_FULL_ROW 0xFFFFu
+#define TETRIS_PAD 4
+
+inline constexpr TetrisPieceTables TETRIS_TABLES = tetris_make_piece_tables(TETRIS_COLS);
+
+typedef struct
+{
+    // rows[TETRIS_PAD + r] is field row r
+    uint16_t rows[TETRIS_PAD + TETRIS_ROWS + TETRIS_PAD];
+    // 0 = empty, else piece type + 1
+    uint8_t color[TETRIS_ROWS][TETRIS_COLS];
+    // first occupied row of each column, TETRIS_ROWS when empty
+    uint8_t top[TETRIS_COLS];
+    // changes whenever the occupancy does, so derived state can be cached
+    uint32_t serial;
+} TetrisBoard;
+
+static inline void tetris_board_clear(TetrisBoard *b)
+{
+    for (int i = 0; i < TETRIS_PAD + TETRIS_ROWS; i++)
+        b->rows[i] = TETRIS_WALL_MASK;
+    for (int i = TETRIS_PAD + TETRIS_ROWS; i < TETRIS_PAD + TETRIS_ROWS + TETRIS_PAD; i++)
+        b->rows[i] = TETRIS_FULL_ROW;
+    memset(b->color, 0, sizeof(b->color));
+    memset(b->top, TETRIS_ROWS, sizeof(b->top));
+    b->serial++;
+}
+
+// Column tops from the row masks, one pass down the field
+static inline void tetris_update_tops(TetrisBoard *b)
+{
+    uint16_t seen = TETRIS_WALL_MASK;
+    memset(b->top, TETRIS_ROWS, sizeof(b->top));
+    for (int r = 0; r < TETRIS_ROWS && seen != TETRIS_FULL_ROW; r++)
+    {
+        uint16_t fresh = b->rows[TETRIS_PAD + r] & ~seen;
+        seen |= fresh;
+        for (; fresh; fresh &= fresh - 1)
+            b->top[__builtin_ctz(fresh) - TETRIS_WALL] = r;
+    }
+}
+
+static inline uint16_t tetris_row(const TetrisBoard *b, int r)
+{
+    return b->rows[TETRIS_PAD + r];
+}
+
+static inline bool tetris_row_empty(const TetrisBoard *b, int r)
+{
+    return b->rows[TETRIS_PAD + r] == TETRIS_WALL_MASK;
+}
+
+// Piece type t, rotation r with its 4x4 box at column x, row y; rows above
+// the field only check the side walls
+static inline bool tetris_fits(const TetrisBoard *b, int t, int r, int x, int y)
+{
+    if ((unsigned)(x + TETRIS_WALL) > 16 - 4 || y < -TETRIS_PAD || y > TETRIS_ROWS)
+        return false;
+    uint64_t field;
+    memcpy(&field, &b->rows[TETRIS_PAD + y], sizeof(field));
+    return (field & (TETRIS_TABLES.rows[t][r] << (x + TETRIS_WALL))) == 0;
+}
+
+// Cells outside the field are dropped, as the byte board did
+static inline void tetris_lock(TetrisBoard *b, int t, int r, int x, int y)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        uint8_t cell = TETRIS_TABLES.cells[t][r][i];
+        int row = y + (cell >> 2), col = x + (cell & 3);
+        if (row < 0 || row >= TETRIS_ROWS || col < 0 || col >= TETRIS_COLS)
+            continue;
+        b->rows[TETRIS_PAD + row] |= 1u << (col + TETRIS_WALL);
+        b->color[row][col] = t + 1;
+        if (row < b->top[col])
+            b->top[col] = row;
+    }
+    b->serial++;
+}
+
+// Removes the full rows among rows y..y + 3, the box of the piece just
+// locked (no other row can have filled up), and moves the rows above down in
+// one pass, each by the number of cleared rows below it. Returns how many
+// rows went; cleared_rows, when given, gets bit r set for each cleared row r
+// (row numbers before the clear).
+static inline int tetris_clear_lines(TetrisBoard *b, int y, uint32_t *cleared_rows)
+{
+    int lo = (y < 0) ? 0 : y;
+    int hi = (y + 3 < TETRIS_ROWS - 1) ? y + 3 : TETRIS_ROWS - 1;
+    uint32_t full = 0;
+    for (int r = lo; r <= hi; r++)
+        if (b->rows[TETRIS_PAD + r] == TETRIS_FULL_ROW)
+            full |= 1u << r;
+    if (cleared_rows)
+        *cleared_rows = full;
+    if (!full)
+        return 0;
+
+    // rows above the highest column top are empty already
+    int stack_top = TETRIS_ROWS;
+    for (int c = 0; c < TETRIS_COLS; c++)
+        stack_top = (b->top[c] < stack_top) ? b->top[c] : stack_top;
+
+    int dst = hi;
+    for (int src = hi; src >= stack_top; src--)
+    {
+        if (full & (1u << src))
+            continue;
+        if (dst != src)
+        {
+            b->rows[TETRIS_PAD + dst] = b->rows[TETRIS_PAD + src];
+            memcpy(b->color[dst], b->color[src], sizeof(b->color[0]));
+        }
+        dst--;
+    }
+    for (; dst >= stack_top; dst--)
+    {
+        b->rows[TETRIS_PAD + dst] = TETRIS_WALL_MASK;
+        memset(b->color[dst], 0, sizeof(b->color[0]));
+    }
+
+    tetris_update_tops(b);
+    b->serial++;
+    return __builtin_popcount(full);
+}
+
+// Rows a piece that fits at (x, y) can fall. When every mino is above its
+// column's top this comes straight from the column tops; a piece tucked
+// under an overhang falls back to stepping down.
+static inline int tetris_drop_distance(const TetrisBoard *b, int t, int r, int x, int y)
+{
+    const int8_t *bottom = TETRIS_TABLES.bottom[t][r];
+    int drop = TETRIS_ROWS + TETRIS_PAD;
+    for (int xx = 0; xx < 4; xx++)
+    {
+        if (bottom[xx] < 0)
+            continue;
+        int d = b->top[x + xx] - (y + bottom[xx]) - 1;
+        if (d < 0)
+        {
+            drop = 0;
+            while (tetris_fits(b, t, r, x, y + drop + 1))
+                drop++;
+            return drop;
+        }
+        if (d < drop)
+            drop = d;
+    }
+    return drop;
+}
+
+#endif
@@ -0,0 +1,596 @@
+#include <string.h>
+#include "tetris_bot.h"
+
+// a board whose next piece tops out
+#define DEAD (INT32_MIN / 2)
+
+void tetris_bot_init(TetrisBot *bot, int beam, int depth)
+{
+    memset(bot, 0, sizeof(*bot));
+    bot->weights = TETRIS_DEFAULT_WEIGHTS;
+    bot->beam = (beam < 1) ? 1 : (beam > TETRIS_BOT_BEAM_MAX) ? TETRIS_BOT_BEAM_MAX : beam;
+    bot->depth = (depth < 1) ? 1 : (depth > TETRIS_BOT_DEPTH_MAX) ? TETRIS_BOT_DEPTH_MAX : depth;
+    bot->workers = 1;
+    bot->kernel = TETRIS_EVAL_AUTO;
+}
+
+bool tetris_bot_set_workers(TetrisBot *bot, int workers, TetrisBotRun run, void *sched)
+{
+    if (workers > TETRIS_BOT_WORKERS_MAX)
+        return false;
+    bot->workers = (workers < 1 || !run) ? 1 : workers;
+    bot->run = run;
+    bot->sched = sched;
+    return true;
+}
+
+void tetris_bot_set_tt(TetrisBot *bot, TetrisTT *tt)
+{
+    bot->tt = tt;
+}
+
+void tetris_bot_set_rollouts(TetrisBot *bot, int rollouts, int horizon)
+{
+    bot->rollouts = (rollouts < 0) ? 0 : (rollouts > TETRIS_BOT_ROLLOUTS_MAX) ? TETRIS_BOT_ROLLOUTS_MAX : rollouts;
+    bot->horizon = (horizon < 1) ? 1 : (horizon > TETRIS_BOT_HORIZON_MAX) ? TETRIS_BOT_HORIZON_MAX : horizon;
+}
+
+uint64_t tetris_bot_movegen_nodes(const TetrisBot *bot)
+{
+    uint64_t n = 0;
+    for (int w = 0; w < TETRIS_BOT_WORKERS_MAX; w++)
+        n += bot->worker[w].gen.nodes;
+    return n;
+}
+
+uint64_t tetris_bot_deadline_us(const TetrisGame *g)
+{
+    uint64_t lock_us = (uint64_t)TETRIS_LOCK_DELAY_MS * 1000;
+    if (g->grounded)
+        return g->grounded_us + lock_us;
+    // one gravity step per row, one more to find the ground
+    const TetrisPiece &p = g->cur;
+    int rows = tetris_drop_distance(&g->board, p.t, p.r, p.x, p.y);
+    return g->last_fall_us + (uint64_t)(rows + 1) * tetris_game_gravity_ms(g) * 1000 + lock_us;
+}
+
+static bool better(const TetrisBotNode *a, const TetrisBotNode *b)
+{
+    return a->value > b->value || (a->value == b->value && a->order < b->order);
+}
+
+// The beam is kept best first in order[]; the boards themselves stay in
+// their slots, and a full beam reuses the slot of its worst board. With the
+// table on, a position already in the beam keeps whichever is better.
+static void beam_insert(TetrisBot *bot, TetrisBotWorker *w, const TetrisBotNode *n)
+{
+    int count = w->count;
+    if (count == bot->beam && !better(n, &w->nodes[w->order[count - 1]]))
+        return;
+    int slot = -1;
+    if (bot->tt)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            const TetrisBotNode *m = &w->nodes[w->order[i]];
+            if (m->position != n->position)
+                continue;
+            w->dupes++;
+            if (!better(n, m))
+                return;
+            slot = w->order[i];
+            memmove(&w->order[i], &w->order[i + 1], count - i - 1);
+            count--;
+            break;
+        }
+    }
+    if (slot < 0)
+        slot = (count < bot->beam) ? count : w->order[--count];
+    w->nodes[slot] = *n;
+    int i = count;
+    for (; i > 0 && better(n, &w->nodes[w->order[i - 1]]); i--)
+        w->order[i] = w->order[i - 1];
+    w->order[i] = (uint8_t)slot;
+    w->count = count + 1;
+}
+
+// Piece t locked at p on b and full rows cleared, on the row masks alone:
+// rows[r] is field row r after. Returns the rows cleared.
+static int lock_rows(uint16_t *rows, const TetrisBoard *b, int t, const TetrisPlacement &p)
+{
+    memcpy(rows, &b->rows[TETRIS_PAD], TETRIS_ROWS * sizeof(rows[0]));
+    uint64_t piece = TETRIS_TABLES.rows[t][p.r] << (p.x + TETRIS_WALL);
+    int cleared = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        int r = p.y + i;
+        if (r < 0 || r >= TETRIS_ROWS)
+            continue;
+        rows[r] |= (uint16_t)(piece >> (16 * i));
+        if (rows[r] != TETRIS_FULL_ROW)
+            continue;
+        // rows below r are not touched, so going down the box is safe
+        memmove(&rows[1], &rows[0], r * sizeof(rows[0]));
+        rows[0] = TETRIS_WALL_MASK;
+        cleared++;
+    }
+    return cleared;
+}
+
+// Every placement of piece t from (r, x, y) on s's board, into the worker's
+// beam; order numbers the children as a single worker would meet them.
+//
+// A chunk of placements at a time: their row masks go side by side into the
+// worker's rows, the ones the table does not know are scored together by
+// tetris_features_batch(), and only children that make the beam get a full
+// board.
+static void expand(TetrisBot *bot, TetrisBotWorker *w, const TetrisBotNode *s, int t, int r, int x, int y, bool hold,
+                   int held, int next, uint32_t order)
+{
+    TetrisMoveGen *gen = &w->gen;
+    int n = tetris_movegen(gen, &s->board, t, r, x, y);
+    bool first = bot->ply == 0;
+    TetrisBotNode child;
+    for (int base = 0; base < n; base += TETRIS_BOT_CHUNK)
+    {
+        int m = (n - base < TETRIS_BOT_CHUNK) ? n - base : TETRIS_BOT_CHUNK;
+        uint64_t key[TETRIS_BOT_CHUNK];
+        int32_t value[TETRIS_BOT_CHUNK];
+        uint8_t cleared[TETRIS_BOT_CHUNK], slot[TETRIS_BOT_CHUNK];
+        int pending = 0;
+        for (int i = 0; i < m; i++)
+        {
+            const TetrisPlacement &p = gen->place[base + i];
+            uint16_t rows[TETRIS_ROWS];
+            cleared[i] = (uint8_t)lock_rows(rows, &s->board, t, p);
+            key[i] = cleared[i] ? tetris_zobrist_rows(rows) : tetris_zobrist_piece(s->key, t, p.r, p.x, p.y);
+            if (rows[0] != TETRIS_WALL_MASK)
+            {
+                value[i] = DEAD;
+                continue;
+            }
+            if (bot->tt)
+            {
+                w->tt_probes++;
+                if (tetris_tt_probe(bot->tt, key[i], &value[i]))
+                {
+                    w->tt_hits++;
+                    continue;
+                }
+            }
+            for (int j = 0; j < TETRIS_ROWS; j++)
+                w->rows[j][pending] = rows[j];
+            slot[pending++] = (uint8_t)i;
+        }
+
+        tetris_features_batch(&w->rows[0][0], TETRIS_BOT_CHUNK, pending, w->features, bot->kernel);
+        for (int k = 0; k < pending; k++)
+        {
+            int32_t v = tetris_eval(&bot->weights, &w->features[k]);
+            if (bot->tt && v >= -(1 << 23) && v < (1 << 23))
+                tetris_tt_store(bot->tt, key[slot[k]], v);
+            value[slot[k]] = v;
+        }
+
+        for (int i = 0; i < m; i++)
+        {
+            const TetrisPlacement &p = gen->place[base + i];
+            w->evaluated++;
+            child.cleared = s->cleared + bot->weights.clear[cleared[i]];
+            child.value = (value[i] == DEAD) ? DEAD : child.cleared + value[i];
+            child.order = order + (uint32_t)(base + i);
+            if (w->count == bot->beam && !better(&child, &w->nodes[w->order[w->count - 1]]))
+                continue;
+            child.board = s->board;
+            tetris_lock(&child.board, t, p.r, p.x, p.y);
+            tetris_clear_lines(&child.board, p.y, NULL);
+            child.key = key[i];
+            child.held = (int8_t)held;
+            child.next = (uint8_t)next;
+            child.position = tetris_zobrist_position(child.key, held, next);
+            if (first)
+            {
+                child.first_hold = hold;
+                child.first_r = p.r;
+                child.first_x = p.x;
+                child.first_y = p.y;
+            }
+            else
+            {
+                child.first_hold = s->first_hold;
+                child.first_r = s->first_r;
+                child.first_x = s->first_x;
+                child.first_y = s->first_y;
+            }
+            beam_insert(bot, w, &child);
+        }
+    }
+}
+
+static bool past_deadline(TetrisBot *bot)
+{
+    if (__atomic_load_n(&bot->cancel, __ATOMIC_RELAXED))
+        return true;
+    if (!bot->deadline_us || !bot->clock_us || bot->ply == 0 || bot->clock_us() < bot->deadline_us)
+        return false;
+    __atomic_store_n(&bot->cancel, true, __ATOMIC_RELAXED);
+    return true;
+}
+
+// Task k of a ply: board k of the beam, with and without hold
+static void expand_task(void *ctx, int k, int worker)
+{
+    TetrisBot *bot = (TetrisBot *)ctx;
+    if (past_deadline(bot))
+        return;
+    TetrisBotWorker *w = &bot->worker[worker];
+    const TetrisBotNode *s = &bot->nodes[bot->side][k];
+    uint32_t order = (uint32_t)k << 12; // placements < 1 << 10 per piece
+    if (s->next >= bot->seq_len)
+    {
+        // held its way past the last piece it knows
+        TetrisBotNode carry = *s;
+        carry.order = order;
+        beam_insert(bot, w, &carry);
+        return;
+    }
+
+    const TetrisGame *g = bot->game;
+    int t = bot->seq[s->next];
+    bool first = bot->ply == 0;
+    if (first)
+        expand(bot, w, s, t, g->cur.r, g->cur.x, g->cur.y, false, s->held, s->next + 1, order);
+    else
+        expand(bot, w, s, t, 0, TETRIS_TABLES.spawn_x[t], 0, false, s->held, s->next + 1, order);
+
+    // hold, once per piece; the piece out of hold starts at spawn
+    if (first && g->hold_used)
+        return;
+    order |= 1u << 10;
+    if (s->held < 0 && s->next + 1 < bot->seq_len)
+    {
+        int u = bot->seq[s->next + 1];
+        expand(bot, w, s, u, 0, TETRIS_TABLES.spawn_x[u], 0, true, t, s->next + 2, order);
+    }
+    else if (s->held >= 0 && s->held != t)
+    {
+        int u = s->held;
+        expand(bot, w, s, u, 0, TETRIS_TABLES.spawn_x[u], 0, true, t, s->next + 1, order);
+    }
+}
+
+// The worker beams, merged best first into the other side; with the table
+// on, a position another worker has already given is dropped
+static int merge(TetrisBot *bot, int out)
+{
+    int head[TETRIS_BOT_WORKERS_MAX] = {0};
+    int count = 0;
+    while (count < bot->beam)
+    {
+        const TetrisBotNode *best = NULL;
+        int from = 0;
+        for (int i = 0; i < bot->workers; i++)
+        {
+            TetrisBotWorker *w = &bot->worker[i];
+            if (head[i] == w->count)
+                continue;
+            const TetrisBotNode *n = &w->nodes[w->order[head[i]]];
+            if (!best || better(n, best))
+            {
+                best = n;
+                from = i;
+            }
+        }
+        if (!best)
+            break;
+        head[from]++;
+        if (bot->tt)
+        {
+            int i = 0;
+            while (i < count && bot->nodes[out][i].position != best->position)
+                i++;
+            if (i < count)
+            {
+                bot->dupes++;
+                continue;
+            }
+        }
+        bot->nodes[out][count++] = *best;
+    }
+    bot->count[out] = count;
+    return count;
+}
+
+#define ALL_PIECES ((1u << TETRIS_PIECES) - 1)
+
+// Future k: each piece is one of those still in its bag (left, then full
+// bags), picked at random, or by the digits of k in the mixed radix of the
+// choices when rng is NULL, so k = 0.. counts through every future once
+static void deal_future(uint8_t *out, int n, uint8_t left, uint32_t *rng, uint32_t k)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (!left)
+            left = ALL_PIECES;
+        uint32_t m = (uint32_t)__builtin_popcount(left);
+        uint32_t pick = rng ? tetris_xorshift32(rng) % m : k % m;
+        k /= m;
+        uint8_t bits = left;
+        for (; pick; pick--)
+            bits &= bits - 1;
+        int t = __builtin_ctz(bits);
+        out[i] = (uint8_t)t;
+        left &= ~(1u << t);
+    }
+}
+
+// Futures there are for n pieces past the preview, or limit + 1 when more
+static uint32_t count_futures(int n, uint8_t left, uint32_t limit)
+{
+    uint32_t futures = 1;
+    for (int i = 0; i < n && futures <= limit; i++)
+    {
+        if (!left)
+            left = ALL_PIECES;
+        futures *= (uint32_t)__builtin_popcount(left);
+        left &= left - 1;
+    }
+    return (futures > limit) ? limit + 1 : futures;
+}
+
+// The rollout policy: piece t hard dropped from the top in every rotation
+// and column where it fits there, scored by tetris_eval() plus the line
+// clear, best locked on b. Returns the lines cleared, -1 when every drop
+// tops out.
+static int greedy_drop(TetrisBot *bot, TetrisBotWorker *w, TetrisBoard *b, int t)
+{
+    // rotations that give different shapes, by type (tetris_pieces.h order)
+    static const uint8_t ROTATIONS[TETRIS_PIECES] = {2, 1, 4, 2, 2, 4, 4};
+    TetrisPlacement place[TETRIS_BOT_CHUNK], best = {};
+    uint8_t cleared[TETRIS_BOT_CHUNK];
+    int32_t best_value = DEAD;
+    int n = 0;
+    for (int r = 0; r < ROTATIONS[t]; r++)
+    {
+        for (int x = -TETRIS_WALL; x <= TETRIS_COLS; x++)
+        {
+            bool last = r == ROTATIONS[t] - 1 && x == TETRIS_COLS;
+            if (!last && tetris_fits(b, t, r, x, 0))
+            {
+                TetrisPlacement &p = place[n];
+                p.r = (int8_t)r;
+                p.x = (int8_t)x;
+                p.y = (int8_t)tetris_drop_distance(b, t, r, x, 0);
+                uint16_t rows[TETRIS_ROWS];
+                cleared[n] = (uint8_t)lock_rows(rows, b, t, p);
+                if (rows[0] == TETRIS_WALL_MASK)
+                {
+                    for (int j = 0; j < TETRIS_ROWS; j++)
+                        w->rows[j][n] = rows[j];
+                    n++;
+                }
+            }
+            // score a full chunk, and what is left after the last drop
+            if (n < TETRIS_BOT_CHUNK && !(last && n))
+                continue;
+            tetris_features_batch(&w->rows[0][0], TETRIS_BOT_CHUNK, n, w->features, bot->kernel);
+            for (int i = 0; i < n; i++)
+            {
+                int32_t v = bot->weights.clear[cleared[i]] + tetris_eval(&bot->weights, &w->features[i]);
+                if (v > best_value)
+                {
+                    best_value = v;
+                    best = place[i];
+                }
+            }
+            n = 0;
+        }
+    }
+    if (best_value == DEAD)
+        return -1;
+    tetris_lock(b, t, best.r, best.x, best.y);
+    return tetris_clear_lines(b, best.y, NULL);
+}
+
+// Candidate s played through the rest of the preview and then future: line
+// clears on the way plus tetris_eval() of the board at the end
+static int32_t rollout(TetrisBot *bot, TetrisBotWorker *w, const TetrisBotNode *s, const uint8_t *future)
+{
+    TetrisBoard b = s->board;
+    int32_t value = 0;
+    for (int i = s->next; i < bot->seq_len + bot->horizon; i++)
+    {
+        int t = (i < bot->seq_len) ? bot->seq[i] : future[i - bot->seq_len];
+        int lines = greedy_drop(bot, w, &b, t);
+        if (lines < 0)
+            return DEAD;
+        value += bot->weights.clear[lines];
+    }
+    TetrisFeatures f;
+    tetris_features(&b, &f);
+    return value + tetris_eval(&bot->weights, &f);
+}
+
+// Task k of the rollouts: future k, every candidate through it
+static void rollout_task(void *ctx, int k, int worker)
+{
+    TetrisBot *bot = (TetrisBot *)ctx;
+    if (past_deadline(bot))
+        return;
+    uint64_t seed = (uint64_t)bot->plans << 32 | (uint32_t)k;
+    uint32_t rng = (uint32_t)tetris_splitmix64(&seed) | 1;
+    uint8_t future[TETRIS_BOT_HORIZON_MAX];
+    deal_future(future, bot->horizon, bot->bag_left, bot->enumerate ? NULL : &rng, (uint32_t)k);
+    for (int c = 0; c < bot->candidates; c++)
+        bot->outcome[k][c] = rollout(bot, &bot->worker[worker], bot->candidate[c], future);
+    bot->played[k] = true;
+}
+
+static bool same_first(const TetrisBotNode *a, const TetrisBotNode *b)
+{
+    return a->first_hold == b->first_hold && a->first_r == b->first_r && a->first_x == b->first_x &&
+           a->first_y == b->first_y;
+}
+
+// The candidate with the best mean over the rollouts; the best board of the
+// beam when there is nothing to compare or no rollout finished in time
+static const TetrisBotNode *monte_carlo(TetrisBot *bot)
+{
+    const TetrisBotNode *beam = bot->nodes[bot->side];
+    int n = 0;
+    for (int i = 0; i < bot->count[bot->side] && n < TETRIS_BOT_CANDIDATES; i++)
+    {
+        int j = 0;
+        while (j < n && !same_first(bot->candidate[j], &beam[i]))
+            j++;
+        if (j == n && beam[i].value != DEAD)
+            bot->candidate[n++] = &beam[i];
+    }
+    if (n < 2)
+        return &beam[0];
+    bot->candidates = n;
+
+    uint32_t futures = count_futures(bot->horizon, bot->bag_left, (uint32_t)bot->rollouts);
+    bot->enumerate = futures <= (uint32_t)bot->rollouts;
+    int count = bot->enumerate ? (int)futures : bot->rollouts;
+    memset(bot->played, 0, count * sizeof(bot->played[0]));
+    if (bot->run && bot->workers > 1)
+        bot->run(bot->sched, count, rollout_task, bot);
+    else
+        for (int k = 0; k < count; k++)
+            rollout_task(bot, k, 0);
+
+    int64_t sum[TETRIS_BOT_CANDIDATES] = {0};
+    int played = 0;
+    for (int k = 0; k < count; k++)
+    {
+        if (!bot->played[k])
+            continue;
+        played++;
+        for (int c = 0; c < n; c++)
+            sum[c] += bot->outcome[k][c];
+    }
+    if (!played)
+        return &beam[0];
+    bot->rolled += played;
+    bot->exact += bot->enumerate && played == count;
+    int best = 0;
+    for (int c = 1; c < n; c++)
+        if (sum[c] > sum[best])
+            best = c;
+    bot->overruled += best != 0;
+    return bot->candidate[best];
+}
+
+bool tetris_bot_plan(TetrisBot *bot, const TetrisGame *g, TetrisPlan *plan)
+{
+    // the pieces to come, in order
+    int n = 0;
+    bot->seq[n++] = g->cur.t;
+    for (int i = 0; i < g->queue.count && n < TETRIS_BOT_DEPTH_MAX; i++)
+        bot->seq[n++] = tetris_queue_peek(&g->queue, i);
+    bot->seq_len = n;
+    bot->bag_left = tetris_queue_bag_left(&g->queue);
+    bot->game = g;
+    int depth = (bot->depth < n) ? bot->depth : n;
+
+    TetrisBotNode *root = &bot->nodes[0][0];
+    root->board = g->board;
+    root->cleared = 0;
+    root->value = 0;
+    root->order = 0;
+    root->key = tetris_zobrist_board(&g->board);
+    root->position = 0;
+    root->held = (int8_t)g->held.t;
+    root->next = 0;
+    bot->count[0] = 1;
+    bot->side = 0;
+    bot->cancel = false;
+    if (bot->tt)
+        tetris_tt_new_search(bot->tt);
+
+    int ply = 0;
+    for (; ply < depth; ply++)
+    {
+        bot->ply = ply;
+        if (past_deadline(bot))
+            break;
+        for (int i = 0; i < bot->workers; i++)
+            bot->worker[i].count = 0;
+        if (bot->run && bot->workers > 1)
+            bot->run(bot->sched, bot->count[bot->side], expand_task, bot);
+        else
+            for (int k = 0; k < bot->count[bot->side]; k++)
+                expand_task(bot, k, 0);
+        for (int i = 0; i < bot->workers; i++)
+        {
+            TetrisBotWorker *w = &bot->worker[i];
+            bot->evaluated += w->evaluated;
+            bot->tt_probes += w->tt_probes;
+            bot->tt_hits += w->tt_hits;
+            bot->dupes += w->dupes;
+            w->evaluated = w->tt_probes = w->tt_hits = w->dupes = 0;
+        }
+        if (__atomic_load_n(&bot->cancel, __ATOMIC_RELAXED))
+            break;
+        if (!merge(bot, bot->side ^ 1))
+            return false;
+        bot->side ^= 1;
+    }
+    bot->plans++;
+    bot->cut += ply < depth;
+
+    // the moves to the first placement behind the best board, or behind the
+    // candidate the rollouts liked best
+    const TetrisBotNode *best = &bot->nodes[bot->side][0];
+    if (bot->rollouts && ply == depth)
+    {
+        bot->ply = ply;
+        best = monte_carlo(bot);
+    }
+    TetrisPiece start = g->cur;
+    if (best->first_hold)
+    {
+        start.t = (g->held.t >= 0) ? g->held.t : tetris_queue_peek(&g->queue, 0);
+        start.r = 0;
+        start.x = TETRIS_TABLES.spawn_x[start.t];
+        start.y = 0;
+    }
+    TetrisMoveGen *gen = &bot->worker[0].gen;
+    int count = tetris_movegen(gen, &g->board, start.t, start.r, start.x, start.y);
+    for (int i = 0; i < count; i++)
+    {
+        const TetrisPlacement &p = gen->place[i];
+        if (p.r == best->first_r && p.x == best->first_x && p.y == best->first_y)
+        {
+            plan->hold = best->first_hold;
+            plan->target.t = start.t;
+            plan->target.r = p.r;
+            plan->target.x = p.x;
+            plan->target.y = p.y;
+            plan->value = best->value;
+            plan->depth = ply;
+            plan->count = tetris_movegen_path(gen, i, plan->moves, TETRIS_BOT_MAX_MOVES);
+            return true;
+        }
+    }
+    return false;
+}
+
+void tetris_bot_play(TetrisGame *g, const TetrisPlan *plan)
+{
+    if (plan->hold)
+        tetris_game_hold(g);
+    for (int i = 0; i < plan->count; i++)
+    {
+        switch (plan->moves[i])
+        {
+        case TETRIS_MOVE_LEFT:  tetris_game_move(g, -1); break;
+        case TETRIS_MOVE_RIGHT: tetris_game_move(g, 1); break;
+        case TETRIS_MOVE_CW:    tetris_game_rotate(g, 1); break;
+        case TETRIS_MOVE_CCW:   tetris_game_rotate(g, -1); break;
+        case TETRIS_MOVE_DOWN:  tetris_game_soft_drop(g); break;
+        }
+    }
+    tetris_game_hard_drop(g);
+}
@@ -0,0 +1,197 @@
+#ifndef TETRIS_BOT_H_
+#define TETRIS_BOT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tetris_game.h"
+#include "tetris_movegen.h"
+#include "tetris_eval.h"
+#include "tetris_tt.h"
+
+// A player for TetrisGame. Beam search over the pieces it can see: the
+// current one, the preview and the hold slot. Each ply places the next piece
+// of every board in the beam everywhere tetris_movegen() reaches (and, with
+// hold, the held piece instead, or the one after when the slot is empty),
+// scores the results with tetris_eval() plus what their line clears are
+// worth, and keeps the best `beam` for the next ply. The plan is the first
+// placement on the way to the best board after `depth` plies, with the moves
+// that get there; tetris_bot_play() presses them through the same calls the
+// buttons use.
+//
+// The boards of a ply are expanded as independent tasks, one per board in
+// the beam, each worker into its own generator and beam; the worker beams
+// are merged by (value, order found), so the plan does not depend on how
+// many workers there are or which took what. The caller supplies the
+// scheduler (tetris_bot_set_workers()); without one worker 0 does it all.
+//
+// With a transposition table (tetris_bot_set_tt()), board evaluations are
+// looked up by Zobrist key before they are computed, within a search and
+// across them, and a ply keeps one board of each position (board, hold and
+// queue position) that different move orders reach: the best, by the order
+// above, so the plan still does not depend on the workers.
+//
+// With rollouts on (tetris_bot_set_rollouts()), the plan also looks past
+// the preview. The 7-bag makes the pieces there anything but random: the
+// current bag still holds the types the preview has not shown
+// (tetris_queue_bag_left()), then whole bags follow. The best board behind
+// each of the first few distinct first placements in the final beam becomes
+// a candidate; every rollout deals one future consistent with the bag and
+// plays each candidate through the rest of the preview and `horizon` pieces
+// of that future with a cheap greedy policy (the best hard drop by
+// tetris_eval(), no hold). All candidates see the same futures, so they are
+// compared on equal luck, and the best mean wins. When the bag leaves no more
+// futures than there are rollouts, every one of them is played once instead
+// of sampling, and the mean is exact.
+//
+// A deadline cuts the search short: a ply still running when it passes is
+// dropped and the plan comes from the last full one. The first ply always
+// runs, so there is always a plan.
+//
+// Placements are scored a chunk at a time with tetris_features_batch(),
+// SIMD on the host and SWAR on the device.
+//
+// Nothing is allocated; the bot is about 15 KB per worker plus the beams,
+// so give it static storage on the device.
+//
+//   static TetrisBot bot;
+//   tetris_bot_init(&bot, 8, 3);
+//   TetrisPlan plan;
+//   if (tetris_bot_plan(&bot, &game, &plan))
+//       tetris_bot_play(&game, &plan);
+
+#ifndef TETRIS_BOT_BEAM_MAX
+#define TETRIS_BOT_BEAM_MAX 32
+#endif
+#ifndef TETRIS_BOT_WORKERS_MAX
+#define TETRIS_BOT_WORKERS_MAX 2
+#endif
+#define TETRIS_BOT_DEPTH_MAX (1 + TETRIS_PREVIEW)
+#define TETRIS_BOT_MAX_MOVES 128
+#define TETRIS_BOT_CHUNK 32 // placements scored together
+#ifndef TETRIS_BOT_ROLLOUTS_MAX
+#define TETRIS_BOT_ROLLOUTS_MAX 64
+#endif
+#define TETRIS_BOT_CANDIDATES 4  // first placements the rollouts compare
+#define TETRIS_BOT_HORIZON_MAX 14 // pieces past the preview
+
+typedef struct
+{
+    bool hold;          // press hold first
+    TetrisPiece target; // where the piece locks
+    int32_t value;      // of the best board found behind it
+    int depth;          // plies searched, less than asked when the deadline cut in
+    int count;
+    uint8_t moves[TETRIS_BOT_MAX_MOVES]; // TETRIS_MOVE_*, from where the piece starts
+} TetrisPlan;
+
+typedef struct
+{
+    TetrisBoard board;
+    int32_t cleared; // line clear rewards on the way here
+    int32_t value;   // cleared + tetris_eval() of the board
+    uint32_t order;  // breaks ties in value: the order a single worker finds them
+    uint64_t key;      // Zobrist key of the board
+    uint64_t position; // and with hold and queue position
+    int8_t held;     // piece type in hold, -1 = none
+    uint8_t next;    // index of the next piece to place
+    // first placement on the way here
+    bool first_hold;
+    int8_t first_r, first_x, first_y;
+} TetrisBotNode;
+
+typedef struct
+{
+    TetrisMoveGen gen;
+    TetrisBotNode nodes[TETRIS_BOT_BEAM_MAX];
+    uint8_t order[TETRIS_BOT_BEAM_MAX]; // best first
+    int count;
+    // a chunk of placements side by side, for tetris_features_batch()
+    uint16_t rows[TETRIS_ROWS][TETRIS_BOT_CHUNK];
+    TetrisFeatures features[TETRIS_BOT_CHUNK];
+    uint64_t evaluated, tt_probes, tt_hits, dupes;
+} TetrisBotWorker;
+
+// Runs fn(ctx, task, worker) for every task in [0, count) on workers
+// 0..n-1 and returns when all are done
+typedef void (*TetrisBotTask)(void *ctx, int task, int worker);
+typedef void (*TetrisBotRun)(void *sched, int count, TetrisBotTask fn, void *ctx);
+
+typedef struct
+{
+    TetrisWeights weights;
+    TetrisEvalKernel kernel; // for tetris_features_batch()
+    int beam;  // boards kept per ply, up to TETRIS_BOT_BEAM_MAX
+    int depth; // plies, up to TETRIS_BOT_DEPTH_MAX
+
+    int workers;
+    TetrisBotRun run;
+    void *sched;
+
+    TetrisTT *tt; // NULL = none
+
+    int rollouts; // per plan, 0 = none
+    int horizon;  // pieces each rollout deals past the preview
+
+    // time limit, on the clock given; 0 = none
+    uint64_t (*clock_us)(void);
+    uint64_t deadline_us;
+    bool cancel;
+
+    // the beam of the last full ply, best first
+    TetrisBotNode nodes[2][TETRIS_BOT_BEAM_MAX];
+    int count[2];
+
+    // the ply being expanded
+    const TetrisGame *game;
+    int seq[TETRIS_BOT_DEPTH_MAX];
+    int seq_len;
+    int ply, side;
+
+    // the rollouts of the plan
+    uint8_t bag_left; // tetris_queue_bag_left() of the game
+    bool enumerate;   // every future once, not a sample
+    int candidates;
+    const TetrisBotNode *candidate[TETRIS_BOT_CANDIDATES];
+    int32_t outcome[TETRIS_BOT_ROLLOUTS_MAX][TETRIS_BOT_CANDIDATES];
+    bool played[TETRIS_BOT_ROLLOUTS_MAX];
+
+    TetrisBotWorker worker[TETRIS_BOT_WORKERS_MAX];
+
+    // over all plans, for benchmarks
+    uint64_t evaluated; // placements scored
+    uint64_t tt_probes; // evaluations looked up
+    uint64_t tt_hits;   // and found
+    uint64_t dupes;     // boards dropped from a ply as transpositions
+    uint32_t plans;
+    uint32_t cut;       // plans the deadline cut short
+    uint64_t rolled;    // rollouts played, each over every candidate
+    uint32_t exact;     // plans that enumerated their futures
+    uint32_t overruled; // plans where the rollouts changed the first placement
+} TetrisBot;
+
+void tetris_bot_init(TetrisBot *bot, int beam, int depth);
+// The scheduler's worker count, up to TETRIS_BOT_WORKERS_MAX (false when
+// over); run = NULL runs everything on worker 0
+bool tetris_bot_set_workers(TetrisBot *bot, int workers, TetrisBotRun run, void *sched);
+
+// Shares tt between all workers and searches; NULL turns it off
+void tetris_bot_set_tt(TetrisBot *bot, TetrisTT *tt);
+
+// Rollouts per plan, up to TETRIS_BOT_ROLLOUTS_MAX (0 turns them off), each
+// dealing horizon pieces past the preview, 1..TETRIS_BOT_HORIZON_MAX
+void tetris_bot_set_rollouts(TetrisBot *bot, int rollouts, int horizon);
+
+// Picks the move for g's current piece; false when it has nowhere to go
+bool tetris_bot_plan(TetrisBot *bot, const TetrisGame *g, TetrisPlan *plan);
+
+// Holds if planned, presses the moves and hard drops
+void tetris_bot_play(TetrisGame *g, const TetrisPlan *plan);
+
+// When g's current piece locks if nothing is pressed: the rows left to fall
+// at the level's gravity, then the lock delay. On g's clock.
+uint64_t tetris_bot_deadline_us(const TetrisGame *g);
+
+// positions the generators expanded, over all workers
+uint64_t tetris_bot_movegen_nodes(const TetrisBot *bot);
+
+#endif
@@ -0,0 +1,254 @@
+#include <string.h>
+#include "tetris_eval.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TETRIS_EVAL_X86 1
+#define SSE2 __attribute__((target("sse2")))
+#define AVX2 __attribute__((target("avx2")))
+#endif
+
+// every helper below is inlined into the kernel that sets the register
+// width, so no vector is ever passed in a call
+#define INLINE inline __attribute__((always_inline))
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+// Many boards in the lanes of one word: 16 bits each, the row masks of
+// board i + l in lane l. Every feature is counted per bit position first,
+// in bit-sliced counters (plane j holds bit j of every position's count, so
+// adding a row is a few ANDs and XORs for all columns of all lanes at once),
+// and only the totals are popcounted, once per plane at the end. Column
+// heights fall out as the count of rows at or below each column's top;
+// bumpiness is a bit-sliced subtraction of those counters from their
+// neighbours'. The same code runs on GCC vector types (one SSE2 or AVX2
+// register) and on a plain uint32_t (two boards, SWAR): every shift that
+// could carry a bit into the next lane is masked to the field afterwards.
+
+template <class V> static INLINE V splat(uint16_t c)
+{
+    V v = {};
+    return v + c;
+}
+
+template <> INLINE uint32_t splat<uint32_t>(uint16_t c)
+{
+    return c * 0x00010001u;
+}
+
+template <class V> static INLINE void load(V *v, const uint16_t *p)
+{
+    memcpy(v, p, sizeof(V));
+}
+
+template <> INLINE void load<uint32_t>(uint32_t *v, const uint16_t *p)
+{
+    *v = p[0] | (uint32_t)p[1] << 16;
+}
+
+// plane counters: p += x, one bit per position
+template <class V> static INLINE void add_bits(V *p, int planes, const V &x)
+{
+    V carry = x;
+    for (int j = 0; j < planes; j++)
+    {
+        V t = p[j] & carry;
+        p[j] ^= carry;
+        carry = t;
+    }
+}
+
+// p += q, q with fewer planes
+template <class V> static INLINE void add_planes(V *p, int planes, const V *q, int q_planes)
+{
+    V carry = {};
+    for (int j = 0; j < planes; j++)
+    {
+        V b = (j < q_planes) ? q[j] : V{};
+        V a = p[j];
+        p[j] = a ^ b ^ carry;
+        carry = (a & b) | (carry & (a ^ b));
+    }
+}
+
+// per-lane popcount of 16-bit lanes
+template <class V> static INLINE void count(V *x)
+{
+    *x = *x - ((*x >> 1) & splat<V>(0x5555));
+    *x = (*x & splat<V>(0x3333)) + ((*x >> 2) & splat<V>(0x3333));
+    *x = (*x + (*x >> 4)) & splat<V>(0x0F0F);
+    *x = (*x + (*x >> 8)) & splat<V>(0x001F);
+}
+
+// sum over the planes of popcount(plane & mask) << j
+template <class V> static INLINE void total(V *sum, const V *p, int planes, const V &mask)
+{
+    *sum = V{};
+    for (int j = 0; j < planes; j++)
+    {
+        V c = p[j] & mask;
+        count(&c);
+        *sum += c << j;
+    }
+}
+
+template <class V> static INLINE void store(uint16_t *out, const V &v)
+{
+    memcpy(out, &v, sizeof(V));
+}
+
+template <> INLINE void store<uint32_t>(uint16_t *out, const uint32_t &v)
+{
+    out[0] = (uint16_t)v;
+    out[1] = (uint16_t)(v >> 16);
+}
+
+// counts fit: 5 bits for a column's height, holes, transitions and the
+// current well depth (21 rows at most), 8 for a column's well sum (231)
+template <class V> static INLINE void features_sliced(const uint16_t *rows, int stride, TetrisFeatures *out)
+{
+    const int LANES = sizeof(V) / 2;
+    const V field = splat<V>((uint16_t)~TETRIS_WALL_MASK);
+    const V edges = splat<V>(TETRIS_TRANSITION_MASK);
+    V cov = {};
+    V hgt[5] = {}, hol[5] = {}, trn[5] = {}, run[5] = {}, wel[8] = {};
+    for (int r = 0; r < TETRIS_ROWS; r++)
+    {
+        V row;
+        load(&row, &rows[r * stride]);
+        cov |= row;
+        add_bits(hgt, 5, cov & field);
+        add_bits(hol, 5, cov & ~row);
+        add_bits(trn, 5, (row ^ (row >> 1)) & edges);
+
+        // run = rows of well so far in each column: one more where this
+        // row is well (open, both sides filled or wall), else none
+        V well = ~cov & (cov << 1) & (cov >> 1) & field;
+        V carry = ~V{};
+        for (int j = 0; j < 5; j++)
+        {
+            V t = run[j] & carry;
+            run[j] = (run[j] ^ carry) & well;
+            carry = t;
+        }
+        add_planes(wel, 8, run, 5);
+    }
+
+    // |h[c] - h[c + 1]| for columns 0..8: subtract, then negate where the
+    // result went below zero
+    V d[5], borrow = {};
+    for (int j = 0; j < 5; j++)
+    {
+        V a = hgt[j], b = hgt[j] >> 1;
+        d[j] = a ^ b ^ borrow;
+        borrow = (~a & b) | (~(a ^ b) & borrow);
+    }
+    for (int j = 0; j < 5; j++)
+        d[j] ^= borrow;
+    add_bits(d, 5, borrow);
+
+    V sum;
+    uint16_t lane[5][LANES];
+    total(&sum, hgt, 5, field);
+    store(lane[0], sum);
+    total(&sum, hol, 5, field);
+    store(lane[1], sum);
+    total(&sum, d, 5, splat<V>((uint16_t)(((1u << (TETRIS_COLS - 1)) - 1) << TETRIS_WALL)));
+    store(lane[2], sum);
+    total(&sum, wel, 8, field);
+    store(lane[3], sum);
+    total(&sum, trn, 5, edges);
+    store(lane[4], sum);
+    for (int l = 0; l < LANES; l++)
+    {
+        out[l].height = lane[0][l];
+        out[l].holes = lane[1][l];
+        out[l].bumpiness = lane[2][l];
+        out[l].wells = lane[3][l];
+        out[l].transitions = lane[4][l];
+    }
+}
+
+static void features_swar(const uint16_t *rows, int stride, TetrisFeatures *out)
+{
+    features_sliced<uint32_t>(rows, stride, out);
+}
+
+#if TETRIS_EVAL_X86
+typedef uint16_t u16x8 __attribute__((vector_size(16)));
+typedef uint16_t u16x16 __attribute__((vector_size(32)));
+
+SSE2 static void features_sse2(const uint16_t *rows, int stride, TetrisFeatures *out)
+{
+    features_sliced<u16x8>(rows, stride, out);
+}
+
+AVX2 static void features_avx2(const uint16_t *rows, int stride, TetrisFeatures *out)
+{
+    features_sliced<u16x16>(rows, stride, out);
+}
+#endif
+
+const char *tetris_eval_kernel_name(TetrisEvalKernel kernel)
+{
+    switch (kernel)
+    {
+    case TETRIS_EVAL_AUTO:   return "auto";
+    case TETRIS_EVAL_SCALAR: return "scalar";
+    case TETRIS_EVAL_SWAR:   return "swar32";
+    case TETRIS_EVAL_SSE2:   return "sse2";
+    case TETRIS_EVAL_AVX2:   return "avx2";
+    }
+    return "?";
+}
+
+bool tetris_eval_kernel_supported(TetrisEvalKernel kernel)
+{
+    switch (kernel)
+    {
+    case TETRIS_EVAL_AUTO:
+    case TETRIS_EVAL_SCALAR:
+    case TETRIS_EVAL_SWAR:
+        return true;
+#if TETRIS_EVAL_X86
+    case TETRIS_EVAL_SSE2: return __builtin_cpu_supports("sse2");
+    case TETRIS_EVAL_AVX2: return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+static TetrisEvalKernel resolve(TetrisEvalKernel kernel)
+{
+    static TetrisEvalKernel best = TETRIS_EVAL_AUTO;
+    if (kernel != TETRIS_EVAL_AUTO)
+        return kernel;
+    if (best == TETRIS_EVAL_AUTO)
+    {
+        if (tetris_eval_kernel_supported(TETRIS_EVAL_AVX2))
+            best = TETRIS_EVAL_AVX2;
+        else if (tetris_eval_kernel_supported(TETRIS_EVAL_SSE2))
+            best = TETRIS_EVAL_SSE2;
+        else
+            best = TETRIS_EVAL_SWAR;
+    }
+    return best;
+}
+
+void tetris_features_batch(const uint16_t *rows, int stride, int n, TetrisFeatures *out, TetrisEvalKernel kernel)
+{
+    kernel = resolve(kernel);
+    int i = 0;
+#if TETRIS_EVAL_X86
+    if (kernel == TETRIS_EVAL_AVX2)
+        for (; i + 16 <= n; i += 16)
+            features_avx2(rows + i, stride, out + i);
+    if (kernel >= TETRIS_EVAL_SSE2)
+        for (; i + 8 <= n; i += 8)
+            features_sse2(rows + i, stride, out + i);
+#endif
+    if (kernel >= TETRIS_EVAL_SWAR)
+        for (; i + 2 <= n; i += 2)
+            features_swar(rows + i, stride, out + i);
+    for (; i < n; i++)
+        tetris_features_rows(rows + i, stride, out + i);
+}
@@ -0,0 +1,106 @@
+#ifndef TETRIS_EVAL_H_
+#define TETRIS_EVAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tetris_board.h"
+
+// How good a board is to play on, for the bot: a weighted sum of a few
+// features of the stack, all integer so it costs the same on the M0+ as
+// anywhere. Higher is better.
+//
+// Features come from the row masks alone, one board at a time
+// (tetris_features()) or many at once (tetris_features_batch(), in
+// tetris_eval.cpp, with SIMD on the host and 32-bit SWAR on the device).
+
+typedef struct
+{
+    int height;      // sum of column heights
+    int holes;       // empty cells with a filled cell somewhere above
+    int bumpiness;   // sum of height steps between neighbouring columns
+    int wells;       // 1 + 2 + .. + depth over every column lower than both sides
+    int transitions; // filled/empty changes along each row, walls included
+} TetrisFeatures;
+
+typedef struct
+{
+    int16_t height, holes, bumpiness, wells, transitions;
+    int16_t clear[5]; // by lines cleared at once
+} TetrisWeights;
+
+// Close to the usual hand-tuned set for this feature mix (height, holes and
+// bumpiness from the well-known genetic search, scaled by 1000), plus mild
+// well and row transition terms; line clears are worth the same per line
+// whatever the size.
+inline constexpr TetrisWeights TETRIS_DEFAULT_WEIGHTS = {-510, -360, -184, -60, -40, {0, 760, 1520, 2280, 3040}};
+
+// bits between two cells of a row, walls included: (row ^ row >> 1) there
+// is a transition
+#define TETRIS_TRANSITION_MASK ((uint16_t)(((1u << (TETRIS_COLS + 1)) - 1) << (TETRIS_WALL - 1)))
+
+// rows[r * stride] is field row r (TetrisBoard.rows encoding, walls set)
+static inline void tetris_features_rows(const uint16_t *rows, int stride, TetrisFeatures *f)
+{
+    // a column's height is set by the first row that fills it; holes are
+    // the empty cells under anything filled above
+    int h[TETRIS_COLS] = {0};
+    uint32_t above = 0;
+    f->holes = 0;
+    f->transitions = 0;
+    for (int r = 0; r < TETRIS_ROWS; r++)
+    {
+        uint32_t row = rows[r * stride];
+        uint32_t field = row & (uint16_t)~TETRIS_WALL_MASK;
+        for (uint32_t fresh = field & ~above; fresh; fresh &= fresh - 1)
+            h[__builtin_ctz(fresh) - TETRIS_WALL] = TETRIS_ROWS - r;
+        f->holes += __builtin_popcount(above & ~field);
+        f->transitions += __builtin_popcount((row ^ (row >> 1)) & TETRIS_TRANSITION_MASK);
+        above |= field;
+    }
+
+    f->height = 0;
+    f->bumpiness = 0;
+    f->wells = 0;
+    for (int c = 0; c < TETRIS_COLS; c++)
+    {
+        f->height += h[c];
+        if (c + 1 < TETRIS_COLS)
+            f->bumpiness += (h[c] > h[c + 1]) ? h[c] - h[c + 1] : h[c + 1] - h[c];
+        // the walls count as full columns
+        int left = c ? h[c - 1] : TETRIS_ROWS;
+        int right = (c + 1 < TETRIS_COLS) ? h[c + 1] : TETRIS_ROWS;
+        int d = ((left < right) ? left : right) - h[c];
+        if (d > 0)
+            f->wells += d * (d + 1) / 2;
+    }
+}
+
+static inline void tetris_features(const TetrisBoard *b, TetrisFeatures *f)
+{
+    tetris_features_rows(&b->rows[TETRIS_PAD], 1, f);
+}
+
+static inline int32_t tetris_eval(const TetrisWeights *w, const TetrisFeatures *f)
+{
+    return (int32_t)w->height * f->height + (int32_t)w->holes * f->holes + (int32_t)w->bumpiness * f->bumpiness +
+           (int32_t)w->wells * f->wells + (int32_t)w->transitions * f->transitions;
+}
+
+typedef enum
+{
+    TETRIS_EVAL_AUTO,
+    TETRIS_EVAL_SCALAR, // tetris_features_rows() per board
+    TETRIS_EVAL_SWAR,   // 2 boards per 32-bit word, for the M0+
+    TETRIS_EVAL_SSE2,   // 8 boards per register
+    TETRIS_EVAL_AVX2,   // 16
+} TetrisEvalKernel;
+
+// Features of boards 0..n-1, the same as tetris_features_rows() gives:
+// rows[r * stride + i] is field row r of board i, the layout of
+// TetrisBatch.rows. AUTO takes the widest kernel this CPU runs.
+void tetris_features_batch(const uint16_t *rows, int stride, int n, TetrisFeatures *out, TetrisEvalKernel kernel);
+
+const char *tetris_eval_kernel_name(TetrisEvalKernel kernel);
+bool tetris_eval_kernel_supported(TetrisEvalKernel kernel);
+
+#endif
@@ -0,0 +1,286 @@
+#include <string.h>
+#include "tetris_game.h"
+
+bool tetris_game_fits(const TetrisGame *g, const TetrisPiece *p)
+{
+    return tetris_fits(&g->board, p->t, p->r, p->x, p->y);
+}
+
+static void spawn(TetrisGame *g, int t)
+{
+    g->cur.t = t;
+    g->cur.r = 0;
+    g->cur.x = TETRIS_TABLES.spawn_x[t];
+    g->cur.y = 0;
+}
+
+static void new_piece_from_queue(TetrisGame *g)
+{
+    spawn(g, tetris_queue_pop(&g->queue));
+    // game over: start again on an empty field, the bag carries on
+    if (!tetris_row_empty(&g->board, 0))
+    {
+        g->top_outs++;
+        g->final_score = g->score;
+        tetris_board_clear(&g->board);
+        g->score = 0;
+        g->lines = 0;
+        g->level = 1;
+        tetris_queue_restart(&g->queue);
+    }
+}
+
+void tetris_game_init(TetrisGame *g, uint32_t seed, uint64_t now_us)
+{
+    memset(g, 0, sizeof(*g));
+    tetris_board_clear(&g->board);
+    tetris_queue_init(&g->queue, seed);
+    g->held.t = -1;
+    g->ghost_key.t = -1;
+    g->level = 1;
+    new_piece_from_queue(g);
+    g->last_fall_us = now_us;
+    g->last_soft_us = now_us;
+}
+
+int tetris_game_gravity_ms(const TetrisGame *g)
+{
+    if (g->level < 2)  return 700;
+    if (g->level < 4)  return 500;
+    if (g->level < 6)  return 380;
+    if (g->level < 8)  return 300;
+    if (g->level < 10) return 220;
+    if (g->level < 12) return 160;
+    if (g->level < 15) return 120;
+    if (g->level < 18) return 90;
+    return 70;
+}
+
+static bool grounded(const TetrisGame *g)
+{
+    TetrisPiece t = g->cur;
+    t.y++;
+    return !tetris_game_fits(g, &t);
+}
+
+bool tetris_game_move(TetrisGame *g, int dx)
+{
+    TetrisPiece t = g->cur;
+    t.x += dx;
+    if (!tetris_game_fits(g, &t))
+        return false;
+    g->cur = t;
+    return true;
+}
+
+bool tetris_game_rotate(TetrisGame *g, int dir)
+{
+    const TetrisPiece &pc = g->cur;
+    TetrisPiece test = pc;
+    test.r = (pc.r + (dir > 0 ? 1 : 3)) & 3;
+
+    int set = TETRIS_TABLES.kick_set[pc.t];
+    const int8_t (*kick)[2] = TETRIS_TABLES.kicks[set][pc.r][dir > 0 ? 0 : 1];
+    for (int i = 0; i < TETRIS_TABLES.kick_tests[set]; i++)
+    {
+        test.x = pc.x + kick[i][0];
+        test.y = pc.y + kick[i][1];
+        if (tetris_game_fits(g, &test))
+        {
+            g->cur = test;
+            return true;
+        }
+    }
+    return false;
+}
+
+const TetrisPiece *tetris_game_ghost(TetrisGame *g)
+{
+    const TetrisPiece &p = g->cur, &key = g->ghost_key;
+    if (p.t != key.t || p.r != key.r || p.x != key.x || p.y != key.y || g->board.serial != g->ghost_serial)
+    {
+        g->ghost_key = p;
+        g->ghost_serial = g->board.serial;
+        g->ghost = p;
+        g->ghost.y += tetris_drop_distance(&g->board, p.t, p.r, p.x, p.y);
+    }
+    return &g->ghost;
+}
+
+static void on_piece_locked(TetrisGame *g)
+{
+    static const int pts[5] = {0, 40, 100, 300, 1200};
+
+    g->hold_used = false;
+    tetris_lock(&g->board, g->cur.t, g->cur.r, g->cur.x, g->cur.y);
+    g->pieces++;
+    int cl = tetris_clear_lines(&g->board, g->cur.y, &g->cleared_rows);
+    if (cl)
+    {
+        g->lines += cl;
+        g->score += pts[cl] * g->level;
+        g->level = 1 + g->lines / 10;
+    }
+    new_piece_from_queue(g);
+    g->grounded = false;
+}
+
+void tetris_game_hard_drop(TetrisGame *g)
+{
+    const TetrisPiece *ghost = tetris_game_ghost(g);
+    int dy = ghost->y - g->cur.y;
+    if (dy > 0)
+        g->score += 2 * dy;
+    g->cur = *ghost;
+    on_piece_locked(g);
+}
+
+// once per turn; the held piece comes back in spawn position
+void tetris_game_hold(TetrisGame *g)
+{
+    if (g->hold_used)
+        return;
+    g->hold_used = true;
+
+    TetrisPiece swap = g->cur;
+    if (g->held.t == -1)
+        new_piece_from_queue(g);
+    else
+        spawn(g, g->held.t);
+    g->held = swap;
+}
+
+bool tetris_game_soft_drop(TetrisGame *g)
+{
+    TetrisPiece t = g->cur;
+    t.y++;
+    if (!tetris_game_fits(g, &t))
+        return false;
+    g->cur = t;
+    g->grounded = false;
+    g->score++;
+    return true;
+}
+
+// One row down, or start the lock delay; locks once the delay has run out
+// when lock is set (gravity), never for soft drop
+static void step_down(TetrisGame *g, uint64_t now_us, bool lock)
+{
+    if (tetris_game_soft_drop(g))
+        return;
+    if (!g->grounded)
+    {
+        g->grounded = true;
+        g->grounded_us = now_us;
+    }
+    else if (lock && now_us - g->grounded_us >= (uint64_t)TETRIS_LOCK_DELAY_MS * 1000)
+    {
+        on_piece_locked(g);
+    }
+}
+
+// DAS/ARR: a press moves once, holding for TETRIS_DAS_MS starts repeating
+// every TETRIS_ARR_MS
+static void shift_update(TetrisGame *g, TetrisShift *s, bool pressed, int dx, uint64_t now_ms)
+{
+    if (pressed && !s->down)
+    {
+        s->down = true;
+        s->pressed_ms = now_ms;
+        s->repeat_ms = now_ms;
+        s->repeating = false;
+        tetris_game_move(g, dx);
+    }
+    else if (pressed)
+    {
+        if (!s->repeating && now_ms - s->pressed_ms >= TETRIS_DAS_MS)
+        {
+            s->repeating = true;
+            s->repeat_ms = now_ms;
+            tetris_game_move(g, dx);
+        }
+        else if (s->repeating && now_ms - s->repeat_ms >= TETRIS_ARR_MS)
+        {
+            s->repeat_ms = now_ms;
+            tetris_game_move(g, dx);
+        }
+    }
+    else if (s->down)
+    {
+        s->down = false;
+        s->repeating = false;
+    }
+}
+
+void tetris_game_step(TetrisGame *g, uint32_t buttons, uint64_t now_us)
+{
+    uint32_t pressed = buttons & ~g->prev_buttons;
+    if (pressed & TETRIS_BTN_PAUSE)
+        g->paused = !g->paused;
+    if (g->paused)
+    {
+        // only the pause button is followed while paused
+        g->prev_buttons = (g->prev_buttons & ~TETRIS_BTN_PAUSE) | (buttons & TETRIS_BTN_PAUSE);
+        return;
+    }
+
+    uint64_t now_ms = now_us / 1000;
+    shift_update(g, &g->shift_right, buttons & TETRIS_BTN_RIGHT, +1, now_ms);
+    shift_update(g, &g->shift_left, buttons & TETRIS_BTN_LEFT, -1, now_ms);
+
+    const uint32_t rot = TETRIS_BTN_ROT_CW | TETRIS_BTN_ROT_CCW;
+    if ((buttons & rot) && !(g->prev_buttons & rot))
+    {
+        // a turn that leaves the piece on the ground restarts the lock delay
+        if (tetris_game_rotate(g, (buttons & TETRIS_BTN_ROT_CW) ? +1 : -1) && grounded(g))
+        {
+            g->grounded_us = now_us;
+            g->grounded = true;
+        }
+    }
+
+    if (buttons & TETRIS_BTN_HOLD)
+        tetris_game_hold(g);
+
+    if ((buttons & TETRIS_BTN_SOFT_DROP) && now_us - g->last_soft_us >= TETRIS_SOFT_DROP_US)
+    {
+        g->last_soft_us = now_us;
+        step_down(g, now_us, false);
+    }
+
+    if (pressed & TETRIS_BTN_HARD_DROP)
+        tetris_game_hard_drop(g);
+
+    if (now_us - g->last_fall_us >= (uint64_t)tetris_game_gravity_ms(g) * 1000)
+    {
+        g->last_fall_us = now_us;
+        step_down(g, now_us, true);
+    }
+
+    g->prev_buttons = buttons;
+}
+
+static uint32_t fnv1a(uint32_t h, const void *data, size_t n)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < n; i++)
+        h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+uint32_t tetris_game_hash(const TetrisGame *g)
+{
+    int32_t state[] = {g->cur.t, g->cur.r, g->cur.x, g->cur.y, g->held.t, g->hold_used, g->paused,
+                       g->score, g->lines, g->level, (int32_t)g->pieces};
+    uint32_t h = 2166136261u;
+    h = fnv1a(h, g->board.rows, sizeof(g->board.rows));
+    h = fnv1a(h, g->board.color, sizeof(g->board.color));
+    h = fnv1a(h, state, sizeof(state));
+    for (int i = 0; i < g->queue.count; i++)
+    {
+        uint8_t t = tetris_queue_peek(&g->queue, i);
+        h = fnv1a(h, &t, 1);
+    }
+    h = fnv1a(h, &g->queue.rng, sizeof(g->queue.rng));
+    return h;
+}
@@ -0,0 +1,104 @@
+#ifndef TETRIS_GAME_H_
+#define TETRIS_GAME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tetris_board.h"
+#include "tetris_queue.h"
+
+// The rules of the game (movement with DAS/ARR, SRS rotation, hold, soft and
+// hard drop, gravity by level, lock delay, scoring) with no hardware in
+// sight: time comes in as a microsecond clock and input as a button mask per
+// step. The device feeds it time_us_64() and the GPIOs, the host simulator a
+// virtual clock and a recorded or scripted trace; both play the same game.
+//
+//   TetrisGame g;
+//   tetris_game_init(&g, seed, now_us);
+//   while (...)
+//       tetris_game_step(&g, buttons, now_us);
+
+#define TETRIS_DAS_MS 142       // hold time before auto-shift
+#define TETRIS_ARR_MS 1         // auto-shift repeat
+#define TETRIS_SOFT_DROP_US 10  // soft drop step
+#define TETRIS_LOCK_DELAY_MS 500
+
+enum
+{
+    TETRIS_BTN_LEFT = 1 << 0,
+    TETRIS_BTN_RIGHT = 1 << 1,
+    TETRIS_BTN_ROT_CW = 1 << 2,
+    TETRIS_BTN_ROT_CCW = 1 << 3,
+    TETRIS_BTN_SOFT_DROP = 1 << 4,
+    TETRIS_BTN_HARD_DROP = 1 << 5,
+    TETRIS_BTN_HOLD = 1 << 6,
+    TETRIS_BTN_PAUSE = 1 << 7,
+};
+
+typedef struct
+{
+    int t; // piece type (tetris_pieces.h order), -1 = none
+    int r; // rotation 0..3
+    int x; // box column
+    int y; // box row
+} TetrisPiece;
+
+// auto-shift state of one direction button
+typedef struct
+{
+    bool down;
+    bool repeating;
+    uint64_t pressed_ms;
+    uint64_t repeat_ms;
+} TetrisShift;
+
+typedef struct
+{
+    TetrisBoard board;
+    TetrisQueue queue;
+    TetrisPiece cur;
+    TetrisPiece held;
+    bool hold_used; // this turn
+    bool paused;
+
+    int score;
+    int lines;
+    int level;
+    uint32_t pieces;       // locked since init
+    uint32_t top_outs;     // games ended since init
+    int final_score;       // score of the last game that ended
+    uint32_t cleared_rows; // rows cleared by the last lock, bit r = row r
+
+    uint64_t last_fall_us;
+    uint64_t last_soft_us;
+    uint64_t grounded_us;
+    bool grounded;
+
+    uint32_t prev_buttons;
+    TetrisShift shift_left, shift_right;
+
+    // ghost of cur, valid while cur and board.serial match the key
+    TetrisPiece ghost_key, ghost;
+    uint32_t ghost_serial;
+} TetrisGame;
+
+void tetris_game_init(TetrisGame *g, uint32_t seed, uint64_t now_us);
+// Advances the game to now_us with the buttons held as given
+void tetris_game_step(TetrisGame *g, uint32_t buttons, uint64_t now_us);
+
+// Single actions, as the buttons trigger them
+bool tetris_game_move(TetrisGame *g, int dx);
+bool tetris_game_rotate(TetrisGame *g, int dir);
+void tetris_game_hold(TetrisGame *g);
+void tetris_game_hard_drop(TetrisGame *g);
+// One row down, scored as soft drop; false when something is in the way
+bool tetris_game_soft_drop(TetrisGame *g);
+
+bool tetris_game_fits(const TetrisGame *g, const TetrisPiece *p);
+// Landing position of the current piece
+const TetrisPiece *tetris_game_ghost(TetrisGame *g);
+int tetris_game_gravity_ms(const TetrisGame *g);
+
+// FNV-1a over everything that decides how the game goes on
+uint32_t tetris_game_hash(const TetrisGame *g);
+
+#endif
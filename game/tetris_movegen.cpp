@@ -0,0 +1,146 @@
+#include <string.h>
+#include "tetris_movegen.h"
+
+static inline int node_of(int r, int x, int y)
+{
+    return (r * TETRIS_MOVEGEN_YS + y + TETRIS_PAD) * TETRIS_MOVEGEN_XS + x + TETRIS_WALL;
+}
+
+static inline void node_pos(int n, int *r, int *x, int *y)
+{
+    *x = n % TETRIS_MOVEGEN_XS - TETRIS_WALL;
+    n /= TETRIS_MOVEGEN_XS;
+    *y = n % TETRIS_MOVEGEN_YS - TETRIS_PAD;
+    *r = n / TETRIS_MOVEGEN_YS;
+}
+
+static inline bool test_and_set(uint32_t *bits, int i)
+{
+    uint32_t m = 1u << (i & 31);
+    if (bits[i >> 5] & m)
+        return true;
+    bits[i >> 5] |= m;
+    return false;
+}
+
+static inline void push(TetrisMoveGen *g, int *tail, int from, int move, int n)
+{
+    g->queue[(*tail)++] = n;
+    g->parent[n] = from;
+    g->move[n] = move;
+}
+
+// a shift or drop: the visited test is cheaper than the collision test
+static inline void step(TetrisMoveGen *g, const TetrisBoard *b, int *tail, int from, int move, int r, int x, int y)
+{
+    int n = node_of(r, x, y);
+    if (!(g->visited[n >> 5] & (1u << (n & 31))) && tetris_fits(b, g->t, r, x, y))
+    {
+        g->visited[n >> 5] |= 1u << (n & 31);
+        push(g, tail, from, move, n);
+    }
+}
+
+// the turn tetris_game_rotate() makes: first kick that fits
+static inline bool turn(const TetrisBoard *b, int t, int dir, int r, int *x, int *y)
+{
+    int set = TETRIS_TABLES.kick_set[t];
+    const int8_t (*kick)[2] = TETRIS_TABLES.kicks[set][r][dir > 0 ? 0 : 1];
+    int to = (r + (dir > 0 ? 1 : 3)) & 3;
+    for (int i = 0; i < TETRIS_TABLES.kick_tests[set]; i++)
+    {
+        if (tetris_fits(b, t, to, *x + kick[i][0], *y + kick[i][1]))
+        {
+            *x += kick[i][0];
+            *y += kick[i][1];
+            return true;
+        }
+    }
+    return false;
+}
+
+static void land(TetrisMoveGen *g, const TetrisBoard *b, int n, int r, int x, int y)
+{
+    int t = g->t;
+    uint8_t e = TETRIS_TABLES.extent[t][r];
+    int ax = x + (e & 3), ay = y + (e >> 2 & 3);
+    int key = (TETRIS_TABLES.shape[t][r] * TETRIS_MOVEGEN_YS + ay + TETRIS_PAD) * TETRIS_COLS + ax;
+    if (test_and_set(g->landed, key))
+        return;
+
+    TetrisPlacement *p = &g->place[g->count++];
+    p->r = r;
+    p->x = x;
+    p->y = y;
+    p->node = n;
+    p->flags = 0;
+    if (n != g->queue[0] && !tetris_fits(b, t, r, x - 1, y) && !tetris_fits(b, t, r, x + 1, y) &&
+        !tetris_fits(b, t, r, x, y - 1))
+        p->flags |= TETRIS_PLACE_SPIN;
+    const int8_t *bottom = TETRIS_TABLES.bottom[t][r];
+    for (int xx = 0; xx < 4; xx++)
+        if (bottom[xx] >= 0 && y + bottom[xx] > b->top[x + xx])
+            p->flags |= TETRIS_PLACE_TUCK;
+}
+
+int tetris_movegen(TetrisMoveGen *g, const TetrisBoard *b, int t, int r, int x, int y)
+{
+    g->t = t;
+    g->count = 0;
+    if (!tetris_fits(b, t, r, x, y))
+        return 0;
+    memset(g->visited, 0, sizeof(g->visited));
+    memset(g->landed, 0, sizeof(g->landed));
+
+    int head = 0, tail = 0;
+    int start = node_of(r, x, y);
+    test_and_set(g->visited, start);
+    g->queue[tail++] = start;
+    g->parent[start] = start;
+
+    // every queued position fits; its neighbours are tested before queueing
+    while (head < tail)
+    {
+        int n = g->queue[head++];
+        node_pos(n, &r, &x, &y);
+
+        if (tetris_fits(b, t, r, x, y + 1))
+        {
+            int d = node_of(r, x, y + 1);
+            if (!test_and_set(g->visited, d))
+                push(g, &tail, n, TETRIS_MOVE_DOWN, d);
+        }
+        else
+            land(g, b, n, r, x, y);
+        step(g, b, &tail, n, TETRIS_MOVE_LEFT, r, x - 1, y);
+        step(g, b, &tail, n, TETRIS_MOVE_RIGHT, r, x + 1, y);
+
+        // a turn's result depends on which kick fits, so it is found first
+        for (int dir = 1; dir >= -1; dir -= 2)
+        {
+            int kx = x, ky = y, to = (r + (dir > 0 ? 1 : 3)) & 3;
+            if (!turn(b, t, dir, r, &kx, &ky))
+                continue;
+            int k = node_of(to, kx, ky);
+            if (!test_and_set(g->visited, k))
+                push(g, &tail, n, dir > 0 ? TETRIS_MOVE_CW : TETRIS_MOVE_CCW, k);
+        }
+    }
+    g->nodes += tail;
+    return g->count;
+}
+
+int tetris_movegen_path(const TetrisMoveGen *g, int i, uint8_t *moves, int max)
+{
+    // walk back to the start, then reverse
+    int len = 0;
+    for (int n = g->place[i].node; n != g->queue[0] && len < max; n = g->parent[n])
+        moves[len++] = g->move[n];
+    for (int a = 0, z = len - 1; a < z; a++, z--)
+    {
+        uint8_t tmp = moves[a];
+        moves[a] = moves[z];
+        moves[z] = tmp;
+    }
+    return len;
+}
@@ -0,0 +1,76 @@
+#ifndef TETRIS_MOVEGEN_H_
+#define TETRIS_MOVEGEN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tetris_board.h"
+
+// Every distinct place a piece can lock, found the way a player gets there:
+// a breadth-first search over box positions (x, y, r) from the piece's
+// current position, with shifts, SRS turns (same kick tables as
+// tetris_game_rotate()) and one-row soft drops as the moves. A position the
+// piece cannot leave downwards is a placement; positions reached twice are
+// cut by a visited bitset, and placements that cover the same four cells
+// (S/Z/I turned half way, any O) are kept once. Tucks under overhangs and
+// spins come out of the same search.
+//
+// Nothing is allocated; the generator is about 13 KB, so give it static
+// storage on the device.
+//
+//   static TetrisMoveGen gen;
+//   int n = tetris_movegen(&gen, &board, cur.t, cur.r, cur.x, cur.y);
+//   for (int i = 0; i < n; i++) ... gen.place[i] ...
+
+#define TETRIS_MOVEGEN_XS (16 - 4 + 1)            // box columns x = -TETRIS_WALL..
+#define TETRIS_MOVEGEN_YS (TETRIS_PAD + TETRIS_ROWS) // box rows y = -TETRIS_PAD..
+#define TETRIS_MOVEGEN_NODES (4 * TETRIS_MOVEGEN_YS * TETRIS_MOVEGEN_XS)
+// distinct cell sets: 4 shapes at most, by the top left corner of their extent
+#define TETRIS_MOVEGEN_PLACES (4 * TETRIS_MOVEGEN_YS * TETRIS_COLS)
+
+enum
+{
+    TETRIS_MOVE_LEFT,
+    TETRIS_MOVE_RIGHT,
+    TETRIS_MOVE_CW,
+    TETRIS_MOVE_CCW,
+    TETRIS_MOVE_DOWN, // soft drop one row
+};
+
+enum
+{
+    TETRIS_PLACE_SPIN = 1 << 0, // cannot shift or rise: only a turn gets there
+    TETRIS_PLACE_TUCK = 1 << 1, // a mino is below its column's top
+};
+
+typedef struct
+{
+    int8_t r, x, y; // box position, as TetrisPiece
+    uint8_t flags;
+    uint16_t node; // for tetris_movegen_path()
+} TetrisPlacement;
+
+typedef struct
+{
+    int t;
+    uint32_t visited[(TETRIS_MOVEGEN_NODES + 31) / 32];
+    uint32_t landed[(TETRIS_MOVEGEN_PLACES + 31) / 32];
+    uint16_t queue[TETRIS_MOVEGEN_NODES]; // nodes in the order found
+    uint16_t parent[TETRIS_MOVEGEN_NODES];
+    uint8_t move[TETRIS_MOVEGEN_NODES]; // TETRIS_MOVE_* from the parent
+
+    int count;
+    TetrisPlacement place[TETRIS_MOVEGEN_PLACES];
+
+    // positions expanded over all runs, for benchmarks
+    uint64_t nodes;
+} TetrisMoveGen;
+
+// Placements of piece type t starting from box position (r, x, y); 0 when
+// the piece does not fit there. Results in gen->place[0..count).
+int tetris_movegen(TetrisMoveGen *gen, const TetrisBoard *b, int t, int r, int x, int y);
+
+// Moves from the start position to placement i, in order; returns how many
+// (at most max). The piece then locks where it stands, e.g. by hard drop.
+int tetris_movegen_path(const TetrisMoveGen *gen, int i, uint8_t *moves, int max);
+
+#endif
@@ -0,0 +1,480 @@
+#include <string.h>
+#include "tetris_pc.h"
+
+#define FIELD ((uint16_t)~TETRIS_WALL_MASK)
+
+// memo keys of the rows left to clear, apart from the board's
+struct PCKeys
+{
+    uint64_t rows[TETRIS_PC_MAX_LINES + 1];
+};
+
+static constexpr PCKeys make_keys()
+{
+    PCKeys k{};
+    uint64_t s = 0x9C1EA7ull;
+    for (int h = 0; h <= TETRIS_PC_MAX_LINES; h++)
+        k.rows[h] = tetris_splitmix64(&s);
+    return k;
+}
+
+static constexpr PCKeys KEYS = make_keys();
+
+void tetris_pc_init(TetrisPCSolver *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->flags = TETRIS_PC_PRUNE | TETRIS_PC_MEMO;
+}
+
+void tetris_pc_set_memo(TetrisPCSolver *s, TetrisTT *memo)
+{
+    s->memo = memo;
+}
+
+static bool out_of_budget(TetrisPCSolver *s)
+{
+    if (s->gave_up)
+        return true;
+    if (s->node_limit && s->nodes >= s->node_limit)
+        s->gave_up = true;
+    // the clock is slow on the device, so not every node
+    else if (s->deadline_us && s->clock_us && (s->nodes & 63) == 0 && s->clock_us() >= s->deadline_us)
+        s->gave_up = true;
+    return s->gave_up;
+}
+
+// False when board b cannot be cleared in its bottom h rows with `have`
+// pieces: more empty cells than the pieces fill, or a part of the field
+// walled off from the rest whose empty cells do not come in fours. Between
+// two columns with no row empty on both sides no piece can ever cross: rows
+// only lose empty cells until they clear, and a clear moves whole rows.
+static bool may_clear(const TetrisBoard *b, int h, int have)
+{
+    uint16_t rows[TETRIS_PC_MAX_LINES];
+    uint16_t open = 0;
+    int empty = 0;
+    for (int i = 0; i < h; i++)
+    {
+        rows[i] = ~b->rows[TETRIS_PAD + TETRIS_ROWS - h + i] & FIELD;
+        open |= rows[i] & (rows[i] >> 1);
+        empty += __builtin_popcount(rows[i]);
+    }
+    if (empty > 4 * have)
+        return false;
+    // bit c + 1 of walls: nothing crosses between field columns c and c + 1
+    uint16_t walls = (uint16_t)(~(open << 1) & (FIELD & (FIELD << 1)));
+    for (uint32_t cols = walls; cols; cols &= cols - 1)
+    {
+        uint16_t left = (uint16_t)((cols & -cols) - 1);
+        int n = 0;
+        for (int i = 0; i < h; i++)
+            n += __builtin_popcount(rows[i] & left);
+        if (n % 4)
+            return false;
+    }
+    return true;
+}
+
+// Empty cells piece t at (r, x, y) would cover in the bottom h rows
+static int covers(const TetrisBoard *b, int t, int r, int x, int y)
+{
+    int n = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        int low = TETRIS_TABLES.bottom[t][r][i];
+        if (low < 0)
+            continue;
+        int col = x + i, row = y + low;
+        // empty down to the column's top, unless tucked under it
+        if (row < b->top[col])
+            n += b->top[col] - row - 1;
+        else
+            for (int rr = row + 1; rr < TETRIS_ROWS && !(b->rows[TETRIS_PAD + rr] & (1u << (col + TETRIS_WALL))); rr++)
+                n++;
+    }
+    return n;
+}
+
+// ---- placements
+//
+// The places tetris_movegen() finds (shifts, SRS turns and soft drops from
+// the start; one of each set of cells), a row of box columns at a time:
+// bit x + TETRIS_WALL of fit[r][i] is set where rotation r fits with its
+// box at column x, row lo + i, and of reach[r][i] where the piece gets to.
+// Most places inside the window are straight drops from above the stack;
+// when some are not, the rows are swept from the highest that grew, each
+// filled sideways along its fits, dropped a row and turned with the first
+// kick that fits, until none grows.
+
+#define GEN_ROWS (TETRIS_PAD + TETRIS_ROWS + 1) // box rows -TETRIS_PAD..TETRIS_ROWS
+#define GEN_COLS 0x1FFF                       // box columns -TETRIS_WALL..12 - TETRIS_WALL
+#define GEN_EDGE 2                            // rows a kick moves at most
+
+// m moved dx columns right (left when negative), |dx| <= 4
+static inline uint16_t shift_cols(uint32_t m, int dx)
+{
+    return (uint16_t)((m << 4) >> (4 - dx));
+}
+
+// Box columns where rotation r of t fits against board rows[0..4)
+static inline uint16_t fit_row(const uint16_t *rows, int t, int r)
+{
+    uint32_t blocked = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        uint8_t cell = TETRIS_TABLES.cells[t][r][i];
+        blocked |= (uint32_t)rows[cell >> 2] >> (cell & 3);
+    }
+    return (uint16_t)(~blocked & GEN_COLS);
+}
+
+// c spread both ways along the runs of f it is in (c inside f)
+static inline uint16_t spread(uint32_t c, uint32_t f)
+{
+    uint32_t up = c, down = c, p = f, q = f;
+    up |= p & (up << 1);
+    p &= p << 1;
+    up |= p & (up << 2);
+    p &= p << 2;
+    up |= p & (up << 4);
+    p &= p << 4;
+    up |= p & (up << 8);
+    down |= q & (down >> 1);
+    q &= q >> 1;
+    down |= q & (down >> 2);
+    q &= q >> 2;
+    down |= q & (down >> 4);
+    q &= q >> 4;
+    down |= q & (down >> 8);
+    return (uint16_t)((up | down) & f);
+}
+
+// Where piece t from (r, x, y) can lock on b with its top mino in the
+// bottom h rows: land[r][i] has the box columns of the places in row
+// *lo + i; returns the rows, 0 when the start does not fit
+static int landings(const TetrisBoard *b, int t, int r, int x, int y, int h, uint16_t land[4][GEN_ROWS], int *lo)
+{
+    *lo = 0;
+    if (!tetris_fits(b, t, r, x, y))
+        return 0;
+    int top = TETRIS_ROWS;
+    for (int c = 0; c < TETRIS_COLS; c++)
+        top = (b->top[c] < top) ? b->top[c] : top;
+    // with nothing at or above the start's box rows the piece gets to every
+    // rotation and column in them, and whatever it reaches higher it could
+    // only leave through them: the sweep starts from the whole row
+    bool open = y + 4 <= top;
+    const int from = open ? y : -TETRIS_PAD;
+    const int n = TETRIS_ROWS + 1 - from;
+    // rows k = i + GEN_EDGE, with GEN_EDGE rows either side for the kicks
+    // that leave the sweep: the ones above fit where the field is open and
+    // land nowhere that counts, the ones below never fit
+    uint16_t fit[4][GEN_EDGE + GEN_ROWS + GEN_EDGE], reach[4][GEN_EDGE + GEN_ROWS + GEN_EDGE];
+    uint16_t done[4][GEN_EDGE + GEN_ROWS + GEN_EDGE];
+    uint32_t dirty[4]; // rows of reach[] grown since they were last spread
+    const uint32_t rows_in = ((1u << n) - 1) << GEN_EDGE;
+    // box rows wholly above the stack need no test, and above the sweep
+    // they fit as far up as the padding goes
+    const int open_rows = (top - 4 - from + 1 < 0) ? 0 : top - 4 - from + 1;
+    const int edge = open ? ((from + TETRIS_PAD < GEN_EDGE) ? from + TETRIS_PAD : GEN_EDGE) : 0;
+    static const uint16_t EMPTY[4] = {TETRIS_WALL_MASK, TETRIS_WALL_MASK, TETRIS_WALL_MASK, TETRIS_WALL_MASK};
+    memset(reach, 0, sizeof(reach));
+    for (int q = 0; q < 4; q++)
+    {
+        const uint8_t *cells = TETRIS_TABLES.cells[t][q];
+        const uint16_t *rows = &b->rows[TETRIS_PAD + from];
+        uint16_t fit_open = fit_row(EMPTY, t, q);
+        int k = 0;
+        for (; k < GEN_EDGE - edge; k++)
+            fit[q][k] = 0;
+        for (; k < GEN_EDGE + open_rows; k++)
+            fit[q][k] = fit_open;
+        for (; k < GEN_EDGE + n; k++)
+        {
+            uint32_t blocked = (uint32_t)rows[k - GEN_EDGE + (cells[0] >> 2)] >> (cells[0] & 3);
+            blocked |= (uint32_t)rows[k - GEN_EDGE + (cells[1] >> 2)] >> (cells[1] & 3);
+            blocked |= (uint32_t)rows[k - GEN_EDGE + (cells[2] >> 2)] >> (cells[2] & 3);
+            blocked |= (uint32_t)rows[k - GEN_EDGE + (cells[3] >> 2)] >> (cells[3] & 3);
+            fit[q][k] = (uint16_t)(~blocked & GEN_COLS);
+        }
+        for (; k < GEN_EDGE + n + GEN_EDGE; k++)
+            fit[q][k] = 0;
+        reach[q][GEN_EDGE] = open ? fit[q][GEN_EDGE] : 0;
+        dirty[q] = open ? 1u << GEN_EDGE : 0;
+    }
+    if (!open)
+    {
+        reach[r][GEN_EDGE + y - from] = (uint16_t)(1u << (x + TETRIS_WALL));
+        dirty[r] = 1u << (GEN_EDGE + y - from);
+    }
+
+    // when every place that fits inside the window is a straight drop,
+    // those are all there are; else the sweep goes on from the drops
+    bool straight = open;
+    for (int q = 0; q < 4 && open; q++)
+    {
+        int ey = TETRIS_TABLES.extent[t][q] >> 2 & 3;
+        for (int k = GEN_EDGE + 1; k < GEN_EDGE + n; k++)
+        {
+            reach[q][k] = reach[q][k - 1] & fit[q][k];
+            dirty[q] |= (uint32_t)(reach[q][k] != 0) << k;
+            if (from + k - GEN_EDGE + ey >= TETRIS_ROWS - h)
+                straight = straight && !(fit[q][k] & ~fit[q][k + 1] & ~reach[q][k]);
+        }
+    }
+
+    // highest grown row first, until nothing grows
+    if (!straight)
+        memset(done, 0, sizeof(done));
+    const int set = TETRIS_TABLES.kick_set[t], tests = TETRIS_TABLES.kick_tests[set];
+    for (uint32_t grown; !straight && (grown = (dirty[0] | dirty[1] | dirty[2] | dirty[3]) & rows_in) != 0;)
+    {
+        const int k = __builtin_ctz(grown);
+        for (int q = 0; q < 4; q++)
+        {
+            if (!(dirty[q] >> k & 1))
+                continue;
+            dirty[q] &= ~(1u << k);
+            // only what is new since the last visit moves on
+            uint16_t m = spread(reach[q][k], fit[q][k]);
+            reach[q][k] = m;
+            m &= ~done[q][k];
+            done[q][k] |= m;
+            uint16_t fresh = m & fit[q][k + 1] & ~reach[q][k + 1];
+            reach[q][k + 1] |= fresh;
+            dirty[q] |= (uint32_t)(fresh != 0) << (k + 1);
+            for (int dir = 0; dir < 2; dir++)
+            {
+                int to = (q + (dir ? 3 : 1)) & 3;
+                const int8_t (*kick)[2] = TETRIS_TABLES.kicks[set][q][dir];
+                // each column takes the first kick that fits, as in
+                // tetris_game_rotate()
+                uint16_t left = m;
+                for (int i = 0; i < tests && left; i++)
+                {
+                    int j = k + kick[i][1];
+                    uint16_t ok = shift_cols(left, kick[i][0]) & fit[to][j];
+                    left &= ~shift_cols(ok, -kick[i][0]);
+                    fresh = ok & ~reach[to][j];
+                    reach[to][j] |= fresh;
+                    dirty[to] |= (uint32_t)(fresh != 0) << j;
+                }
+            }
+        }
+    }
+
+    // places the piece cannot drop from, each set of cells once
+    for (int q = 0; q < 4; q++)
+    {
+        uint8_t eq = TETRIS_TABLES.extent[t][q];
+        // only rows whose top mino is inside the bottom h rows
+        int first = TETRIS_ROWS - h - (eq >> 2 & 3) - from;
+        for (int i = 0; i < n; i++)
+            land[q][i] = (i >= first) ? reach[q][GEN_EDGE + i] & ~fit[q][GEN_EDGE + i + 1] : 0;
+        for (int p = 0; p < q; p++)
+        {
+            if (TETRIS_TABLES.shape[t][p] != TETRIS_TABLES.shape[t][q])
+                continue;
+            uint8_t ep = TETRIS_TABLES.extent[t][p];
+            int dx = (eq & 3) - (ep & 3), dy = (eq >> 2 & 3) - (ep >> 2 & 3);
+            for (int i = 0; i < n; i++)
+                if (i + dy >= 0 && i + dy < n)
+                    land[q][i] &= ~shift_cols(land[p][i + dy], -dx);
+        }
+    }
+    *lo = from;
+    return n;
+}
+
+// Placements of piece t from (r, x, y) on s->board[d] inside its bottom h
+// rows, into s->place[d]; returns how many. Likeliest first: perfect clears
+// fill the field bottom up and seldom leave a cell covered, so placements
+// go by the cells they cover, then lowest first. All of them are ranked and
+// the TETRIS_PC_PLACES best kept; dropping any marks the query s->cut.
+static int collect(TetrisPCSolver *s, int d, int t, int r, int x, int y, int h)
+{
+    uint16_t land[4][GEN_ROWS];
+    int lo, n = landings(&s->board[d], t, r, x, y, h, land, &lo);
+    int count = 0;
+    for (int q = 0; q < 4; q++)
+    {
+        int ey = TETRIS_TABLES.extent[t][q] >> 2 & 3;
+        for (int i = 0; i < n; i++)
+            for (uint32_t cols = land[q][i]; cols; cols &= cols - 1)
+            {
+                int px = __builtin_ctz(cols) - TETRIS_WALL, py = lo + i;
+                int covered = covers(&s->board[d], t, q, px, py);
+                int8_t rank = (int8_t)(((covered < 15) ? covered : 15) * 8 + (TETRIS_ROWS - py - ey));
+                if (count == TETRIS_PC_PLACES)
+                {
+                    s->cut = true;
+                    if (s->place[d][count - 1][3] <= rank)
+                        continue;
+                    count--;
+                }
+                int j = count++;
+                for (; j > 0 && s->place[d][j - 1][3] > rank; j--)
+                    memcpy(s->place[d][j], s->place[d][j - 1], sizeof(s->place[d][j]));
+                s->place[d][j][0] = q;
+                s->place[d][j][1] = px;
+                s->place[d][j][2] = py;
+                s->place[d][j][3] = rank;
+            }
+    }
+    return count;
+}
+
+static bool search(TetrisPCSolver *s, int d, int next, int held, int h);
+
+// Piece t placed every way it fits at depth d, then the rest
+static bool try_piece(TetrisPCSolver *s, int d, int t, bool hold, int next, int held, int h)
+{
+    // a new piece starts just above the stack: everything over it is empty,
+    // so the piece gets there from the spawn row in any rotation and column
+    // and the generator need not search the way down
+    bool from_cur = d == 0 && !hold;
+    int n;
+    if (from_cur)
+        n = collect(s, d, t, s->cur.r, s->cur.x, s->cur.y, h);
+    else
+    {
+        const TetrisBoard *b = &s->board[d];
+        int top = TETRIS_ROWS;
+        for (int c = 0; c < TETRIS_COLS; c++)
+            top = (b->top[c] < top) ? b->top[c] : top;
+        n = collect(s, d, t, 0, TETRIS_TABLES.spawn_x[t], top - 4, h);
+    }
+    for (int i = 0; i < n; i++)
+    {
+        int r = s->place[d][i][0], x = s->place[d][i][1], y = s->place[d][i][2];
+        TetrisBoard *b = &s->board[d + 1];
+        *b = s->board[d];
+        tetris_lock(b, t, r, x, y);
+        int cleared = tetris_clear_lines(b, y, NULL);
+        s->path[d].hold = hold;
+        s->path[d].piece.t = t;
+        s->path[d].piece.r = r;
+        s->path[d].piece.x = x;
+        s->path[d].piece.y = y;
+        if (search(s, d + 1, next, held, h - cleared))
+            return true;
+        if (s->gave_up)
+            return false;
+    }
+    return false;
+}
+
+// Board d with sequence piece `next` in play (the current one at depth 0)
+// and `held` in hold; h rows left to clear
+static bool search(TetrisPCSolver *s, int d, int next, int held, int h)
+{
+    if (h == 0)
+    {
+        s->path_len = d;
+        return true;
+    }
+    s->nodes++;
+    if (out_of_budget(s))
+        return false;
+    const TetrisBoard *b = &s->board[d];
+    int have = s->seq_len - next + (held >= 0);
+    if ((s->flags & TETRIS_PC_PRUNE) && !may_clear(b, h, have))
+    {
+        s->pruned++;
+        return false;
+    }
+    if (next >= s->seq_len && held < 0)
+        return false;
+
+    bool memo = s->memo && (s->flags & TETRIS_PC_MEMO);
+    uint64_t key = 0;
+    if (memo)
+    {
+        int32_t value;
+        key = tetris_zobrist_position(tetris_zobrist_board(b), held, next) ^ KEYS.rows[h] ^ s->salt;
+        if (tetris_tt_probe(s->memo, key, &value))
+        {
+            s->memo_hits++;
+            return false;
+        }
+    }
+
+    // the next piece, or hold: the held one instead, or the one after when
+    // the slot is empty
+    bool hold_ok = d > 0 || s->can_hold;
+    if (next < s->seq_len)
+    {
+        int t = s->seq[next];
+        if (try_piece(s, d, t, false, next + 1, held, h))
+            return true;
+        if (hold_ok && held >= 0 && held != t && try_piece(s, d, held, true, next + 1, t, h))
+            return true;
+        if (hold_ok && held < 0 && next + 1 < s->seq_len &&
+            try_piece(s, d, s->seq[next + 1], true, next + 2, t, h))
+            return true;
+    }
+    else if (hold_ok && try_piece(s, d, held, true, next, -1, h))
+    {
+        // the last piece known, out of hold
+        return true;
+    }
+
+    if (memo && !s->gave_up)
+        tetris_tt_store(s->memo, key, 0);
+    return false;
+}
+
+TetrisPCResult tetris_pc_solve(TetrisPCSolver *s, const TetrisBoard *b, const TetrisPiece *cur, int held,
+                               bool can_hold, const int *queue, int count, int max_lines, TetrisPCSolution *out)
+{
+    s->seq_len = 0;
+    s->seq[s->seq_len++] = (int8_t)cur->t;
+    for (int i = 0; i < count && s->seq_len < TETRIS_PC_MAX_PIECES; i++)
+        s->seq[s->seq_len++] = (int8_t)queue[i];
+    s->cur = *cur;
+    s->can_hold = can_hold;
+    s->gave_up = false;
+    s->cut = false;
+    s->node_limit = s->max_nodes ? s->nodes + s->max_nodes : 0;
+    // entries of earlier queries stay in the table but never match
+    uint64_t q = ++s->queries;
+    s->salt = tetris_splitmix64(&q);
+    s->board[0] = *b;
+
+    int filled = 0, stack = 0;
+    for (int r = 0; r < TETRIS_ROWS; r++)
+    {
+        int n = __builtin_popcount(tetris_row(b, r) & FIELD);
+        filled += n;
+        if (n && !stack)
+            stack = TETRIS_ROWS - r;
+    }
+    if (max_lines > TETRIS_PC_MAX_LINES)
+        max_lines = TETRIS_PC_MAX_LINES;
+    int pieces = s->seq_len + (held >= 0);
+    for (int h = stack ? stack : 1; h <= max_lines; h++)
+    {
+        int empty = TETRIS_COLS * h - filled;
+        if (empty % 4 || empty / 4 > pieces)
+            continue;
+        if (search(s, 0, 0, held, h))
+        {
+            out->lines = h;
+            out->count = s->path_len;
+            memcpy(out->step, s->path, s->path_len * sizeof(s->path[0]));
+            return TETRIS_PC_FOUND;
+        }
+        if (s->gave_up)
+            return TETRIS_PC_GAVE_UP;
+    }
+    // placements left out may have held the answer
+    return s->cut ? TETRIS_PC_GAVE_UP : TETRIS_PC_NONE;
+}
+
+TetrisPCResult tetris_pc_solve_game(TetrisPCSolver *s, const TetrisGame *g, int max_lines, TetrisPCSolution *out)
+{
+    int queue[TETRIS_PREVIEW];
+    for (int i = 0; i < g->queue.count; i++)
+        queue[i] = tetris_queue_peek(&g->queue, i);
+    return tetris_pc_solve(s, &g->board, &g->cur, g->held.t, !g->hold_used, queue, g->queue.count, max_lines, out);
+}
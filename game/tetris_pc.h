@@ -0,0 +1,114 @@
+#ifndef TETRIS_PC_H_
+#define TETRIS_PC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tetris_game.h"
+#include "tetris_tt.h"
+
+// Perfect clear search: placements for the pieces to come, hold included,
+// that leave the field empty after clearing at most max_lines rows (the
+// stack's own rows count).
+//
+// A clear of h rows takes every placement inside the bottom h rows (a cell
+// above them could never be cleared), so the search is depth-first over the
+// sequence with each piece everywhere it can reach and lock inside them,
+// lowest h first, and placements that cover fewer empty cells and lie lower
+// before the rest. Branches are cut before they are searched:
+//  - cell count: h rows hold 10 h cells, 4 a piece, so only heights where
+//    the empty cells come in fours are tried, and a branch with fewer pieces
+//    left than it needs stops;
+//  - walled-off regions: where no row has an empty cell on both sides of a
+//    column boundary, no piece can ever cross it (rows only fill up until
+//    they clear, and a clear moves whole rows), so the empty cells on each
+//    side must come in fours too;
+//  - memo: a state (board, pieces used, hold, rows left) that failed once is
+//    kept in a transposition table, and the placement orders that reach it
+//    again stop there.
+// A node budget and a deadline bound the search for the device; running
+// out of either gives TETRIS_PC_GAVE_UP, not an answer. So does a piece
+// with more than TETRIS_PC_PLACES placements when no clear turns up: only
+// the best ranked of them are searched.
+//
+// Nothing is allocated; the solver is about 11 KB plus the table.
+//
+//   static TetrisPCSolver pc;
+//   tetris_pc_init(&pc);
+//   tetris_pc_set_memo(&pc, &tt);
+//   TetrisPCSolution sol;
+//   if (tetris_pc_solve_game(&pc, &game, 4, &sol) == TETRIS_PC_FOUND) ...
+
+#define TETRIS_PC_MAX_LINES 6
+#define TETRIS_PC_MAX_PIECES TETRIS_ZOBRIST_POSITIONS // queue positions the memo tells apart
+#define TETRIS_PC_PLACES 96                           // placements of one piece inside the rows
+
+enum
+{
+    TETRIS_PC_PRUNE = 1 << 0, // cell count and walled-off regions
+    TETRIS_PC_MEMO = 1 << 1,  // failed states, when there is a table
+};
+
+typedef enum
+{
+    TETRIS_PC_NONE,    // no perfect clear with these pieces
+    TETRIS_PC_FOUND,
+    TETRIS_PC_GAVE_UP, // out of nodes or time, or placements left out
+} TetrisPCResult;
+
+typedef struct
+{
+    bool hold;         // press hold first
+    TetrisPiece piece; // where it locks
+} TetrisPCStep;
+
+typedef struct
+{
+    int lines; // rows cleared
+    int count;
+    TetrisPCStep step[TETRIS_PC_MAX_PIECES];
+} TetrisPCSolution;
+
+typedef struct
+{
+    TetrisTT *memo; // NULL = none
+    unsigned flags; // TETRIS_PC_*
+    uint32_t max_nodes; // per query, 0 = no limit
+    // time limit, on the clock given; 0 = none
+    uint64_t (*clock_us)(void);
+    uint64_t deadline_us;
+
+    // the query being searched
+    int8_t seq[TETRIS_PC_MAX_PIECES];
+    int seq_len;
+    TetrisPiece cur;
+    bool can_hold;
+    uint64_t salt;
+    uint64_t node_limit; // nodes at which the query gives up
+    bool gave_up;
+    bool cut; // placements past TETRIS_PC_PLACES left out
+    TetrisBoard board[TETRIS_PC_MAX_PIECES + 1];
+    int8_t place[TETRIS_PC_MAX_PIECES][TETRIS_PC_PLACES][4]; // r, x, y, rank
+    TetrisPCStep path[TETRIS_PC_MAX_PIECES];
+    int path_len;
+
+    // over all queries, for benchmarks
+    uint32_t queries;
+    uint64_t nodes;     // states searched
+    uint64_t pruned;    // cut by cell count or regions
+    uint64_t memo_hits; // cut by the memo
+} TetrisPCSolver;
+
+void tetris_pc_init(TetrisPCSolver *s);
+// Failed states go into memo, NULL turns it off
+void tetris_pc_set_memo(TetrisPCSolver *s, TetrisTT *memo);
+
+// cur: the piece in play, where it is; queue[0..count) the pieces after it;
+// held: type in hold or -1; can_hold: hold is free this turn. Only the
+// pieces given are used, at most TETRIS_PC_MAX_PIECES with cur.
+TetrisPCResult tetris_pc_solve(TetrisPCSolver *s, const TetrisBoard *b, const TetrisPiece *cur, int held,
+                               bool can_hold, const int *queue, int count, int max_lines, TetrisPCSolution *out);
+
+// The same for g, with the pieces its player can see
+TetrisPCResult tetris_pc_solve_game(TetrisPCSolver *s, const TetrisGame *g, int max_lines, TetrisPCSolution *out);
+
+#endif
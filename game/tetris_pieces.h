@@ -0,0 +1,166 @@
+#ifndef TETRIS_PIECES_H_
+#define TETRIS_PIECES_H_
+
+#include <stdint.h>
+
+// Piece, rotation and wall kick tables, generated at compile time from one
+// base definition per piece (shape in spawn orientation, rotation box size)
+// and the clockwise kicks of each kick set. Rotations turn the shape inside
+// its box, counter-clockwise kicks are the clockwise ones of the reverse
+// turn negated. A piece sits in a 4x4 box at (x, y), y pointing down.
+
+enum
+{
+    TETRIS_I,
+    TETRIS_O,
+    TETRIS_T,
+    TETRIS_S,
+    TETRIS_Z,
+    TETRIS_J,
+    TETRIS_L,
+    TETRIS_PIECES
+};
+
+enum
+{
+    TETRIS_KICKS_JLSTZ,
+    TETRIS_KICKS_I,
+    TETRIS_KICKS_O,
+    TETRIS_KICK_SETS
+};
+
+#define TETRIS_KICK_TESTS 5
+
+struct TetrisPieceDef
+{
+    uint8_t size;      // rotation box, 2..4
+    uint8_t x;         // box column inside the 4x4 box
+    const char *shape; // size * size cells of the spawn rotation, 'X' = mino
+    uint8_t kicks;
+};
+
+static constexpr TetrisPieceDef TETRIS_PIECE_DEFS[TETRIS_PIECES] = {
+    {4, 0, "....XXXX........", TETRIS_KICKS_I}, // I
+    {2, 1, "XXXX", TETRIS_KICKS_O},             // O
+    {3, 0, ".X.XXX...", TETRIS_KICKS_JLSTZ},    // T
+    {3, 0, ".XXXX....", TETRIS_KICKS_JLSTZ},    // S
+    {3, 0, "XX..XX...", TETRIS_KICKS_JLSTZ},    // Z
+    {3, 0, "X..XXX...", TETRIS_KICKS_JLSTZ},    // J
+    {3, 0, "..XXXX...", TETRIS_KICKS_JLSTZ},    // L
+};
+
+// SRS, clockwise from rotation r to r + 1: {dx, dy} tried in order
+static constexpr int8_t TETRIS_KICKS_CW[TETRIS_KICK_SETS][4][TETRIS_KICK_TESTS][2] = {
+    { // JLSTZ
+        { { 0, 0}, {-1, 0}, {-1,-1}, { 0,+2}, {-1,+2} },
+        { { 0, 0}, {+1, 0}, {+1,+1}, { 0,-2}, {+1,-2} },
+        { { 0, 0}, {+1, 0}, {+1,-1}, { 0,+2}, {+1,+2} },
+        { { 0, 0}, {-1, 0}, {-1,+1}, { 0,-2}, {-1,-2} },
+    },
+    { // I
+        { { 0, 0}, {-2, 0}, {+1, 0}, {-2,+1}, {+1,-2} },
+        { { 0, 0}, {-1, 0}, {+2, 0}, {-1,-2}, {+2,+1} },
+        { { 0, 0}, {+2, 0}, {-1, 0}, {+2,-1}, {-1,+2} },
+        { { 0, 0}, {+1, 0}, {-2, 0}, {+1,+2}, {-2,-1} },
+    },
+    { // O: turns in place
+    },
+};
+
+struct TetrisPieceTables
+{
+    // four 16-bit row masks in one word: box row yy in bits 16 * yy..,
+    // box column xx at bit xx; shifted left by the board bit of the box's
+    // left edge it lines up with four board rows (see tetris_fits())
+    uint64_t rows[TETRIS_PIECES][4];
+    // the four minos, x | y << 2 inside the box
+    uint8_t cells[TETRIS_PIECES][4][4];
+    // occupied part of the box: x0 | y0 << 2 | (w - 1) << 4 | (h - 1) << 6
+    uint8_t extent[TETRIS_PIECES][4];
+    // lowest mino row in each box column, -1 where the column is empty
+    int8_t bottom[TETRIS_PIECES][4][4];
+    // first rotation with the same minos once the empty box rows and columns
+    // are trimmed (S, Z and I turned half way, any O): the two cover the same
+    // cells where their extents start at the same cell
+    uint8_t shape[TETRIS_PIECES][4];
+    // [kick set][from rotation][0 = cw, 1 = ccw][test] = {dx, dy}
+    int8_t kicks[TETRIS_KICK_SETS][4][2][TETRIS_KICK_TESTS][2];
+    uint8_t kick_set[TETRIS_PIECES];
+    uint8_t kick_tests[TETRIS_KICK_SETS];
+    // box column of a new piece, centered and rounded left; it enters at row 0
+    int8_t spawn_x[TETRIS_PIECES];
+};
+
+constexpr TetrisPieceTables tetris_make_piece_tables(int cols)
+{
+    TetrisPieceTables tb{};
+    for (int t = 0; t < TETRIS_PIECES; t++)
+    {
+        const TetrisPieceDef &d = TETRIS_PIECE_DEFS[t];
+        for (int r = 0; r < 4; r++)
+        {
+            int n = 0, x0 = 3, y0 = 3, x1 = 0, y1 = 0;
+            for (int c = 0; c < 4; c++)
+                tb.bottom[t][r][c] = -1;
+            for (int i = 0; i < d.size * d.size; i++)
+            {
+                if (d.shape[i] != 'X')
+                    continue;
+                int x = i % d.size, y = i / d.size;
+                // r clockwise quarter turns inside the size x size box
+                for (int k = 0; k < r; k++)
+                {
+                    int turned = d.size - 1 - y;
+                    y = x;
+                    x = turned;
+                }
+                x += d.x;
+                tb.rows[t][r] |= (uint64_t)1 << (y * 16 + x);
+                tb.cells[t][r][n++] = (uint8_t)(x | y << 2);
+                if (y > tb.bottom[t][r][x])
+                    tb.bottom[t][r][x] = (int8_t)y;
+                x0 = x < x0 ? x : x0;
+                y0 = y < y0 ? y : y0;
+                x1 = x > x1 ? x : x1;
+                y1 = y > y1 ? y : y1;
+            }
+            tb.extent[t][r] = (uint8_t)(x0 | y0 << 2 | (x1 - x0) << 4 | (y1 - y0) << 6);
+        }
+        for (int r = 0; r < 4; r++)
+        {
+            tb.shape[t][r] = (uint8_t)r;
+            for (int q = 0; q < r; q++)
+            {
+                uint8_t er = tb.extent[t][r], eq = tb.extent[t][q];
+                uint64_t a = tb.rows[t][r] >> (16 * (er >> 2 & 3)) >> (er & 3);
+                uint64_t b = tb.rows[t][q] >> (16 * (eq >> 2 & 3)) >> (eq & 3);
+                // the shift moves whole rows too, so compare lane by lane
+                bool same = true;
+                for (int i = 0; i < 4; i++)
+                    same = same && ((a >> (16 * i)) & 0xF) == ((b >> (16 * i)) & 0xF);
+                if (same)
+                {
+                    tb.shape[t][r] = tb.shape[t][q];
+                    break;
+                }
+            }
+        }
+        tb.kick_set[t] = d.kicks;
+        tb.spawn_x[t] = (int8_t)((cols - 4) / 2);
+    }
+
+    for (int k = 0; k < TETRIS_KICK_SETS; k++)
+    {
+        tb.kick_tests[k] = (k == TETRIS_KICKS_O) ? 1 : TETRIS_KICK_TESTS;
+        for (int r = 0; r < 4; r++)
+            for (int i = 0; i < TETRIS_KICK_TESTS; i++)
+                for (int c = 0; c < 2; c++)
+                {
+                    tb.kicks[k][r][0][i][c] = TETRIS_KICKS_CW[k][r][i][c];
+                    tb.kicks[k][r][1][i][c] = -TETRIS_KICKS_CW[k][(r + 3) & 3][i][c];
+                }
+    }
+    return tb;
+}
+
+#endif
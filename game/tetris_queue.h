@@ -0,0 +1,107 @@
+#ifndef TETRIS_QUEUE_H_
+#define TETRIS_QUEUE_H_
+
+#include <stdint.h>
+#include "tetris_pieces.h"
+
+// 7-bag randomizer feeding a fixed-size preview ring. The bag is shuffled
+// with xorshift32 when it runs dry and dealt in order; the preview is a
+// power-of-two ring so taking the front piece is an index bump.
+
+#define TETRIS_PREVIEW 7
+#define TETRIS_RING 8 // power of two, > TETRIS_PREVIEW
+
+typedef struct
+{
+    uint32_t rng;
+    uint8_t bag[TETRIS_PIECES];
+    uint8_t bag_next; // next piece to deal, TETRIS_PIECES when empty
+    uint8_t ring[TETRIS_RING];
+    uint8_t head;
+    uint8_t count;
+} TetrisQueue;
+
+static inline uint32_t tetris_xorshift32(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static inline int tetris_bag_deal(TetrisQueue *q)
+{
+    if (q->bag_next >= TETRIS_PIECES)
+    {
+        for (int i = 0; i < TETRIS_PIECES; i++)
+            q->bag[i] = i;
+        for (int i = TETRIS_PIECES - 1; i > 0; i--)
+        {
+            int j = tetris_xorshift32(&q->rng) % (i + 1);
+            uint8_t tmp = q->bag[i];
+            q->bag[i] = q->bag[j];
+            q->bag[j] = tmp;
+        }
+        q->bag_next = 0;
+    }
+    return q->bag[q->bag_next++];
+}
+
+// Tops the preview up to TETRIS_PREVIEW pieces
+static inline void tetris_queue_fill(TetrisQueue *q)
+{
+    while (q->count < TETRIS_PREVIEW)
+    {
+        q->ring[(q->head + q->count) & (TETRIS_RING - 1)] = tetris_bag_deal(q);
+        q->count++;
+    }
+}
+
+static inline void tetris_queue_init(TetrisQueue *q, uint32_t seed)
+{
+    q->rng = seed;
+    q->bag_next = TETRIS_PIECES;
+    q->head = 0;
+    q->count = 0;
+    tetris_queue_fill(q);
+}
+
+// Drops the preview but keeps the bag, so the sequence carries on
+static inline void tetris_queue_restart(TetrisQueue *q)
+{
+    q->count = 0;
+    tetris_queue_fill(q);
+}
+
+// i-th upcoming piece, i < TETRIS_PREVIEW
+static inline int tetris_queue_peek(const TetrisQueue *q, int i)
+{
+    return q->ring[(q->head + i) & (TETRIS_RING - 1)];
+}
+
+// Types the current bag still holds past the preview, bit t for type t; 0
+// when it is used up and the next piece opens a fresh bag. Only needs what a
+// player sees and how far into the bag the deal is, not the shuffle: the
+// last bag_next pieces of the full preview came out of this bag.
+static inline uint8_t tetris_queue_bag_left(const TetrisQueue *q)
+{
+    if (q->bag_next >= TETRIS_PIECES)
+        return 0;
+    uint8_t left = (1u << TETRIS_PIECES) - 1;
+    for (int i = q->count - q->bag_next; i < q->count; i++)
+        left &= ~(1u << tetris_queue_peek(q, i));
+    return left;
+}
+
+static inline int tetris_queue_pop(TetrisQueue *q)
+{
+    int t = q->ring[q->head];
+    q->head = (q->head + 1) & (TETRIS_RING - 1);
+    q->count--;
+    tetris_queue_fill(q);
+    return t;
+}
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef TETRIS_TT_H_
+#define TETRIS_TT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "tetris_board.h"
+
+// Zobrist keys for search positions, and a transposition table keyed by
+// them.
+//
+// A board's key is the XOR of one random 64-bit key per filled cell, so
+// locking a piece updates it with four XORs (tetris_zobrist_piece()); a line
+// clear moves whole rows and is recomputed. A position adds the hold slot
+// and how far into the piece queue it is, which together with the board
+// decide everything that can still happen.
+//
+// The table caches what the bot's evaluation makes of a board. Entries are
+// 8 bytes, eight to a 64-byte bucket on one cache line; a key picks its
+// bucket by its low bits and is told apart inside it by its high 32. Each
+// entry is stored as (check ^ data, data), two 32-bit words written and
+// read separately, so search threads can share the table without locks:
+// an entry torn by a concurrent write fails the check and reads as a miss.
+// A full bucket gives up an entry from an earlier search first, else one
+// picked by the key.
+
+#define TETRIS_ZOBRIST_POSITIONS 16 // queue positions told apart
+
+typedef struct
+{
+    uint64_t cell[TETRIS_ROWS][TETRIS_COLS];
+    uint64_t hold[TETRIS_PIECES + 1]; // by held type + 1, 0 = empty
+    uint64_t position[TETRIS_ZOBRIST_POSITIONS];
+} TetrisZobristKeys;
+
+constexpr uint64_t tetris_splitmix64(uint64_t *s)
+{
+    uint64_t z = (*s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+constexpr TetrisZobristKeys tetris_make_zobrist_keys()
+{
+    TetrisZobristKeys k = {};
+    uint64_t s = 0x7E7215ull;
+    for (int r = 0; r < TETRIS_ROWS; r++)
+        for (int c = 0; c < TETRIS_COLS; c++)
+            k.cell[r][c] = tetris_splitmix64(&s);
+    for (int i = 0; i <= TETRIS_PIECES; i++)
+        k.hold[i] = tetris_splitmix64(&s);
+    for (int i = 0; i < TETRIS_ZOBRIST_POSITIONS; i++)
+        k.position[i] = tetris_splitmix64(&s);
+    return k;
+}
+
+inline constexpr TetrisZobristKeys TETRIS_ZOBRIST = tetris_make_zobrist_keys();
+
+// rows[r] is field row r
+static inline uint64_t tetris_zobrist_rows(const uint16_t *rows)
+{
+    uint64_t key = 0;
+    for (int r = 0; r < TETRIS_ROWS; r++)
+    {
+        uint32_t row = rows[r] & (uint16_t)~TETRIS_WALL_MASK;
+        while (row)
+        {
+            key ^= TETRIS_ZOBRIST.cell[r][__builtin_ctz(row) - TETRIS_WALL];
+            row &= row - 1;
+        }
+    }
+    return key;
+}
+
+static inline uint64_t tetris_zobrist_board(const TetrisBoard *b)
+{
+    return tetris_zobrist_rows(&b->rows[TETRIS_PAD]);
+}
+
+// The board key after piece t locks at (r, x, y) and clears no lines
+static inline uint64_t tetris_zobrist_piece(uint64_t key, int t, int r, int x, int y)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        uint8_t cell = TETRIS_TABLES.cells[t][r][i];
+        int row = y + (cell >> 2), col = x + (cell & 3);
+        if (row >= 0 && row < TETRIS_ROWS)
+            key ^= TETRIS_ZOBRIST.cell[row][col];
+    }
+    return key;
+}
+
+// Board key plus hold (type or -1) and queue position
+static inline uint64_t tetris_zobrist_position(uint64_t board_key, int held, int position)
+{
+    return board_key ^ TETRIS_ZOBRIST.hold[held + 1] ^
+           TETRIS_ZOBRIST.position[position & (TETRIS_ZOBRIST_POSITIONS - 1)];
+}
+
+#define TETRIS_TT_WAYS 8
+
+typedef struct alignas(64)
+{
+    uint32_t word[TETRIS_TT_WAYS][2]; // check ^ data, data; 0, 0 = empty
+} TetrisTTBucket;
+
+typedef struct
+{
+    TetrisTTBucket *buckets; // a power of two of them
+    uint32_t mask;
+    uint8_t age; // of the current search, never 0
+} TetrisTT;
+
+// Over storage the caller provides: bytes rounded down to a power of two of
+// buckets, at least one
+static inline void tetris_tt_init(TetrisTT *tt, TetrisTTBucket *buckets, size_t bytes)
+{
+    size_t n = 1;
+    while (n * 2 * sizeof(TetrisTTBucket) <= bytes)
+        n *= 2;
+    tt->buckets = buckets;
+    tt->mask = (uint32_t)(n - 1);
+    tt->age = 1;
+    memset(buckets, 0, n * sizeof(TetrisTTBucket));
+}
+
+static inline size_t tetris_tt_bytes(const TetrisTT *tt)
+{
+    return ((size_t)tt->mask + 1) * sizeof(TetrisTTBucket);
+}
+
+// Entries from before this go first when buckets fill up
+static inline void tetris_tt_new_search(TetrisTT *tt)
+{
+    tt->age = (tt->age == 255) ? 1 : tt->age + 1;
+}
+
+// data: a 24-bit value and the age it was stored at
+static inline bool tetris_tt_probe(const TetrisTT *tt, uint64_t key, int32_t *value)
+{
+    const TetrisTTBucket *b = &tt->buckets[key & tt->mask];
+    uint32_t check = (uint32_t)(key >> 32);
+    for (int i = 0; i < TETRIS_TT_WAYS; i++)
+    {
+        uint32_t data = __atomic_load_n(&b->word[i][1], __ATOMIC_RELAXED);
+        uint32_t x = __atomic_load_n(&b->word[i][0], __ATOMIC_RELAXED);
+        if (data && (x ^ data) == check)
+        {
+            *value = (int32_t)data >> 8;
+            return true;
+        }
+    }
+    return false;
+}
+
+// value must fit in 24 bits
+static inline void tetris_tt_store(TetrisTT *tt, uint64_t key, int32_t value)
+{
+    TetrisTTBucket *b = &tt->buckets[key & tt->mask];
+    uint32_t check = (uint32_t)(key >> 32);
+    int slot = -1;
+    for (int i = 0; i < TETRIS_TT_WAYS && slot < 0; i++)
+    {
+        uint32_t data = __atomic_load_n(&b->word[i][1], __ATOMIC_RELAXED);
+        if (!data || (uint8_t)data != tt->age)
+            slot = i;
+    }
+    if (slot < 0)
+        slot = (int)(check % TETRIS_TT_WAYS);
+    uint32_t data = (uint32_t)value << 8 | tt->age;
+    __atomic_store_n(&b->word[slot][1], data, __ATOMIC_RELAXED);
+    __atomic_store_n(&b->word[slot][0], check ^ data, __ATOMIC_RELAXED);
+}
+
+#endif
@@ -0,0 +1,241 @@
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "game/tetris_batch.h"
+#include "game/tetris_queue.h"
+
+// Game steps/sec of the batched environment (tetris_batch.h) under each
+// kernel this CPU runs, against the same turn-based rules played on an
+// array of TetrisBoard, one game after the other within each step (the
+// order a policy choosing every game's next action drives them in). Every
+// game gets the same random actions in all runs, and the end states must
+// hash the same.
+//
+//   batch_bench [-games N] [-steps N] [-seed N]
+
+struct RefGame
+{
+    TetrisBoard board;
+    TetrisQueue queue; // only its bag is used
+    int t, r, x, y;
+    int32_t score, lines;
+    uint32_t pieces, top_outs;
+};
+
+static void ref_spawn(RefGame *g)
+{
+    g->t = tetris_bag_deal(&g->queue);
+    g->r = 0;
+    g->x = TETRIS_TABLES.spawn_x[g->t];
+    g->y = 0;
+    if (!tetris_row_empty(&g->board, 0))
+    {
+        g->top_outs++;
+        g->score = 0;
+        g->lines = 0;
+        tetris_board_clear(&g->board);
+    }
+}
+
+static void ref_init(RefGame *g, uint32_t seed)
+{
+    memset(g, 0, sizeof(*g));
+    tetris_board_clear(&g->board);
+    g->queue.rng = seed ? seed : 1;
+    g->queue.bag_next = TETRIS_PIECES;
+    ref_spawn(g);
+}
+
+static void ref_lock(RefGame *g)
+{
+    static const int pts[5] = {0, 40, 100, 300, 1200};
+    tetris_lock(&g->board, g->t, g->r, g->x, g->y);
+    g->pieces++;
+    int cl = tetris_clear_lines(&g->board, g->y, NULL);
+    g->score += pts[cl] * (1 + g->lines / 10);
+    g->lines += cl;
+    ref_spawn(g);
+}
+
+static void ref_step(RefGame *g, int action)
+{
+    const TetrisBoard *b = &g->board;
+    switch (action)
+    {
+    case TETRIS_ACT_LEFT:
+    case TETRIS_ACT_RIGHT:
+    {
+        int x = g->x + (action == TETRIS_ACT_LEFT ? -1 : 1);
+        if (tetris_fits(b, g->t, g->r, x, g->y))
+            g->x = x;
+        break;
+    }
+    case TETRIS_ACT_CW:
+    case TETRIS_ACT_CCW:
+    {
+        int ccw = action == TETRIS_ACT_CCW;
+        int r = (g->r + (ccw ? 3 : 1)) & 3;
+        int set = TETRIS_TABLES.kick_set[g->t];
+        for (int i = 0; i < TETRIS_TABLES.kick_tests[set]; i++)
+        {
+            const int8_t *d = TETRIS_TABLES.kicks[set][g->r][ccw][i];
+            if (tetris_fits(b, g->t, r, g->x + d[0], g->y + d[1]))
+            {
+                g->r = r;
+                g->x += d[0];
+                g->y += d[1];
+                break;
+            }
+        }
+        break;
+    }
+    case TETRIS_ACT_DOWN:
+        if (tetris_fits(b, g->t, g->r, g->x, g->y + 1))
+        {
+            g->y++;
+            g->score++;
+        }
+        else
+            ref_lock(g);
+        break;
+    case TETRIS_ACT_DROP:
+    {
+        int dy = tetris_drop_distance(b, g->t, g->r, g->x, g->y);
+        g->y += dy;
+        g->score += 2 * dy;
+        ref_lock(g);
+        break;
+    }
+    }
+}
+
+static uint32_t fnv(uint32_t h, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        h = (h ^ ((v >> (8 * i)) & 0xFF)) * 16777619u;
+    return h;
+}
+
+static uint32_t ref_hash(const std::vector<RefGame> &games)
+{
+    uint32_t h = 2166136261u;
+    for (const RefGame &g : games)
+    {
+        for (int r = 0; r < TETRIS_ROWS; r++)
+            h = fnv(h, tetris_row(&g.board, r));
+        h = fnv(h, g.t | g.r << 8 | (g.x & 0xFF) << 16 | (g.y & 0xFF) << 24);
+        h = fnv(h, g.score);
+        h = fnv(h, g.lines);
+        h = fnv(h, g.pieces);
+        h = fnv(h, g.top_outs);
+    }
+    return h;
+}
+
+static uint32_t batch_hash(const TetrisBatch *b, int games)
+{
+    uint32_t h = 2166136261u;
+    for (int k = 0; k < games; k++)
+    {
+        for (int r = 0; r < TETRIS_ROWS; r++)
+            h = fnv(h, tetris_batch_row(b, k, r));
+        h = fnv(h, b->t[k] | b->r[k] << 8 | (b->x[k] & 0xFF) << 16 | (b->y[k] & 0xFF) << 24);
+        h = fnv(h, b->score[k]);
+        h = fnv(h, b->lines[k]);
+        h = fnv(h, b->pieces[k]);
+        h = fnv(h, b->top_outs[k]);
+    }
+    return h;
+}
+
+// Mostly shifts and turns, a drop now and then, so stacks build up and
+// collisions, kicks and line clears all happen
+static void make_actions(std::vector<uint8_t> &actions, uint32_t seed)
+{
+    static const uint8_t mix[16] = {
+        TETRIS_ACT_NONE, TETRIS_ACT_LEFT, TETRIS_ACT_LEFT,  TETRIS_ACT_LEFT, TETRIS_ACT_RIGHT, TETRIS_ACT_RIGHT,
+        TETRIS_ACT_RIGHT, TETRIS_ACT_CW,  TETRIS_ACT_CW,    TETRIS_ACT_CCW,  TETRIS_ACT_DOWN,  TETRIS_ACT_DOWN,
+        TETRIS_ACT_DOWN, TETRIS_ACT_DOWN, TETRIS_ACT_DROP,  TETRIS_ACT_DROP,
+    };
+    uint32_t s = seed ? seed : 1;
+    for (uint8_t &a : actions)
+        a = mix[tetris_xorshift32(&s) >> 28];
+}
+
+int main(int argc, char **argv)
+{
+    int games = 4096;
+    int steps = 2000;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-games") && i + 1 < argc)
+            games = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-steps") && i + 1 < argc)
+            steps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-seed") && i + 1 < argc)
+            seed = strtoul(argv[++i], NULL, 0);
+        else
+        {
+            fprintf(stderr, "usage: %s [-games N] [-steps N] [-seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (games <= 0 || steps <= 0)
+        return 0;
+
+    // actions[step][game], the batch layout; the reference reads it strided
+    std::vector<uint8_t> actions((size_t)steps * games);
+    make_actions(actions, seed * 2654435761u);
+    double total = (double)steps * games;
+
+    std::vector<RefGame> ref(games);
+    for (int k = 0; k < games; k++)
+        ref_init(&ref[k], seed + (uint32_t)k);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++)
+        for (int k = 0; k < games; k++)
+            ref_step(&ref[k], actions[(size_t)s * games + k]);
+    double ref_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    uint32_t want = ref_hash(ref);
+
+    uint64_t pieces = 0, lines = 0, top_outs = 0;
+    for (const RefGame &g : ref)
+    {
+        pieces += g.pieces;
+        lines += g.lines;
+        top_outs += g.top_outs;
+    }
+    printf("%d games x %d steps: %llu pieces, %llu lines on the final boards, %llu top-outs\n", games, steps,
+           (unsigned long long)pieces, (unsigned long long)lines, (unsigned long long)top_outs);
+    printf("%-10s %8.2f M steps/s              hash %08x\n", "one-by-one", total / ref_s / 1e6, (unsigned)want);
+
+    bool ok = true;
+    const TetrisKernel kernels[] = {TETRIS_KERNEL_SSE2, TETRIS_KERNEL_AVX2};
+    for (TetrisKernel kernel : kernels)
+    {
+        TetrisBatch b;
+        if (!tetris_batch_kernel_supported(kernel))
+        {
+            printf("%-10s not supported here\n", tetris_batch_kernel_name(kernel));
+            continue;
+        }
+        if (!tetris_batch_init(&b, games, seed, NULL, kernel))
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        t0 = std::chrono::steady_clock::now();
+        for (int s = 0; s < steps; s++)
+            tetris_batch_step(&b, &actions[(size_t)s * games]);
+        double batch_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        uint32_t got = batch_hash(&b, games);
+        printf("%-10s %8.2f M steps/s  x%5.2f    hash %08x%s\n", tetris_batch_kernel_name(kernel),
+               total / batch_s / 1e6, ref_s / batch_s, (unsigned)got, got == want ? "" : "  MISMATCH");
+        ok &= got == want;
+        tetris_batch_free(&b);
+    }
+    return ok ? 0 : 1;
+}
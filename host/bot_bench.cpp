@@ -0,0 +1,100 @@
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "bot_pool.h"
+
+// Parallel speedup of the bot's search (game/tetris_bot.h). The same game
+// is played with the search on 1, 2, 4, .. threads of a work-stealing pool;
+// the plans do not depend on the thread count, so every run scores the same
+// placements and ends in the same state, and the time spent planning
+// compares like for like. No deadline.
+//
+//   bot_bench [-pieces N] [-beam N] [-depth N] [-threads N] [-seed N]
+
+struct Run
+{
+    double plan_s;
+    uint64_t evaluated;
+    uint32_t hash;
+    uint64_t steals;
+};
+
+static TetrisBot bot;
+
+static Run play(uint32_t seed, uint32_t pieces, int beam, int depth, unsigned threads)
+{
+    static TetrisGame g;
+    tetris_game_init(&g, seed, 0);
+    tetris_bot_init(&bot, beam, depth);
+    WorkStealPool pool(threads);
+    bot_use_pool(&bot, &pool);
+
+    Run run = {0, 0, 0, 0};
+    uint64_t now = 0;
+    while (g.pieces < pieces)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        TetrisPlan plan;
+        bool ok = tetris_bot_plan(&bot, &g, &plan);
+        run.plan_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (!ok)
+            break;
+        tetris_bot_play(&g, &plan);
+        tetris_game_step(&g, 0, now += 1000);
+    }
+    run.evaluated = bot.evaluated;
+    run.hash = tetris_game_hash(&g);
+    run.steals = pool.steals();
+    return run;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t pieces = 300, seed = 1;
+    int beam = 32, depth = 4;
+    unsigned max_threads = std::thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-pieces") && i + 1 < argc)
+            pieces = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-beam") && i + 1 < argc)
+            beam = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-depth") && i + 1 < argc)
+            depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-threads") && i + 1 < argc)
+            max_threads = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-seed") && i + 1 < argc)
+            seed = strtoul(argv[++i], NULL, 0);
+        else
+        {
+            fprintf(stderr, "usage: %s [-pieces N] [-beam N] [-depth N] [-threads N] [-seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+    // at least one parallel run, so the merge is checked even on one core
+    if (max_threads < 2)
+        max_threads = 2;
+    if (max_threads > TETRIS_BOT_WORKERS_MAX)
+        max_threads = TETRIS_BOT_WORKERS_MAX;
+
+    printf("%u pieces, beam %d, depth %d, %u hardware threads\n", (unsigned)pieces, beam, depth,
+           std::thread::hardware_concurrency());
+    printf("%7s %12s %9s %11s %8s %8s %9s\n", "threads", "placements", "ms", "places/s", "speedup", "steals", "hash");
+    bool ok = true;
+    Run base = {0, 0, 0, 0};
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+    {
+        Run r = play(seed, pieces, beam, depth, threads);
+        if (threads == 1)
+            base = r;
+        bool same = r.hash == base.hash && r.evaluated == base.evaluated;
+        printf("%7u %12llu %9.1f %11.0f %7.2fx %8llu %08x%s\n", threads, (unsigned long long)r.evaluated,
+               r.plan_s * 1e3, r.evaluated / r.plan_s, base.plan_s / r.plan_s, (unsigned long long)r.steals,
+               (unsigned)r.hash, same ? "" : "  MISMATCH");
+        ok &= same;
+    }
+    return ok ? 0 : 1;
+}
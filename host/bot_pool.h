@@ -0,0 +1,29 @@
+#ifndef BOT_POOL_H_
+#define BOT_POOL_H_
+
+#include <chrono>
+#include "game/tetris_bot.h"
+#include "work_steal.h"
+
+// Host glue for game/tetris_bot.h: its ply tasks on a WorkStealPool, and a
+// clock for its deadline.
+
+static inline void bot_pool_run(void *sched, int count, TetrisBotTask fn, void *ctx)
+{
+    static_cast<WorkStealPool *>(sched)->run((size_t)count,
+                                             [=](size_t task, unsigned worker) { fn(ctx, (int)task, (int)worker); });
+}
+
+static inline bool bot_use_pool(TetrisBot *bot, WorkStealPool *pool)
+{
+    return tetris_bot_set_workers(bot, (int)pool->size(), bot_pool_run, pool);
+}
+
+static inline uint64_t bot_clock_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+#endif
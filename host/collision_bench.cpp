@@ -0,0 +1,174 @@
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include "game/tetris_board.h"
+
+// Collision checks/sec of the bitboard (tetris_fits) against the byte board
+// walk it replaced, on the same random stacks and piece positions, and hard
+// drops by stepping against tetris_drop_distance(). Each pair must give the
+// same answers.
+
+static const int BOARDS = 64;
+static const int QUERIES = 4096;
+
+struct Query
+{
+    int8_t t, r, x, y;
+};
+
+static uint8_t bytes[BOARDS][TETRIS_ROWS][TETRIS_COLS];
+static TetrisBoard bits[BOARDS];
+static Query queries[QUERIES];
+
+static uint32_t rng_state = 0x2545F491;
+static uint32_t xorshift32()
+{
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rng_state = x;
+    return x;
+}
+
+// the former can_place() of main.cpp, walking the 4x4 shape of each piece
+static uint8_t shapes[TETRIS_PIECES][4][16];
+
+static bool byte_can_place(const uint8_t (&board)[TETRIS_ROWS][TETRIS_COLS], int t, int rot, int x, int y)
+{
+    const uint8_t *sh = shapes[t][rot];
+    for (int yy = 0; yy < 4; ++yy)
+        for (int xx = 0; xx < 4; ++xx)
+        {
+            if (!sh[yy * 4 + xx])
+                continue;
+            int r = y + yy;
+            int c = x + xx;
+            if (r < 0)
+            {
+                if (c < 0 || c >= TETRIS_COLS)
+                    return false;
+                continue;
+            }
+            if (c < 0 || c >= TETRIS_COLS || r >= TETRIS_ROWS)
+                return false;
+            if (board[r][c])
+                return false;
+        }
+    return true;
+}
+
+// stacks of random height with random holes, one gap per row at least
+static void make_boards()
+{
+    for (int t = 0; t < TETRIS_PIECES; t++)
+        for (int r = 0; r < 4; r++)
+            for (int i = 0; i < 4; i++)
+                shapes[t][r][TETRIS_TABLES.cells[t][r][i]] = 1;
+    for (int b = 0; b < BOARDS; b++)
+    {
+        tetris_board_clear(&bits[b]);
+        memset(bytes[b], 0, sizeof(bytes[b]));
+        int height = xorshift32() % 16;
+        for (int r = TETRIS_ROWS - height; r < TETRIS_ROWS; r++)
+        {
+            int gap = xorshift32() % TETRIS_COLS;
+            for (int c = 0; c < TETRIS_COLS; c++)
+                if (c != gap && xorshift32() % 4)
+                {
+                    bytes[b][r][c] = 1;
+                    bits[b].rows[TETRIS_PAD + r] |= 1u << (c + TETRIS_WALL);
+                    bits[b].color[r][c] = 1;
+                }
+        }
+        tetris_update_tops(&bits[b]);
+    }
+    for (int i = 0; i < QUERIES; i++)
+        queries[i] = Query{(int8_t)(xorshift32() % 7), (int8_t)(xorshift32() % 4),
+                           (int8_t)((int)(xorshift32() % 14) - 3), (int8_t)((int)(xorshift32() % 24) - 2)};
+}
+
+static volatile uint32_t sink;
+
+// one pass over every board and query; returns a checksum of the answers
+template <class F>
+static uint32_t check_pass(F fits)
+{
+    uint32_t h = 0;
+    for (int b = 0; b < BOARDS; b++)
+        for (int i = 0; i < QUERIES; i++)
+            h = h * 3 + fits(b, queries[i]);
+    return h;
+}
+
+// drop every fitting query position to rest, as ghost_of() does
+template <class F>
+static uint32_t drop_pass(F fits)
+{
+    uint32_t h = 0;
+    for (int b = 0; b < BOARDS; b++)
+        for (int i = 0; i < QUERIES; i++)
+        {
+            Query q = queries[i];
+            if (!fits(b, q))
+                continue;
+            while (fits(b, Query{q.t, q.r, q.x, (int8_t)(q.y + 1)}))
+                q.y++;
+            h = h * 3 + q.y;
+        }
+    return h;
+}
+
+// the same drops from the column tops
+static uint32_t drop_distance_pass()
+{
+    uint32_t h = 0;
+    for (int b = 0; b < BOARDS; b++)
+        for (int i = 0; i < QUERIES; i++)
+        {
+            Query q = queries[i];
+            if (!tetris_fits(&bits[b], q.t, q.r, q.x, q.y))
+                continue;
+            h = h * 3 + q.y + tetris_drop_distance(&bits[b], q.t, q.r, q.x, q.y);
+        }
+    return h;
+}
+
+template <class P>
+static double passes_per_sec(P pass)
+{
+    uint32_t passes = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    double elapsed;
+    do
+    {
+        sink = pass();
+        passes++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    } while (elapsed < 0.3);
+    return passes / elapsed;
+}
+
+int main()
+{
+    make_boards();
+
+    auto byte_fits = [](int b, Query q) { return byte_can_place(bytes[b], q.t, q.r, q.x, q.y); };
+    auto bit_fits = [](int b, Query q) { return tetris_fits(&bits[b], q.t, q.r, q.x, q.y); };
+
+    bool agree = check_pass(byte_fits) == check_pass(bit_fits) && drop_pass(byte_fits) == drop_pass(bit_fits) &&
+                 drop_pass(bit_fits) == drop_distance_pass();
+    const double per_pass = (double)BOARDS * QUERIES / 1e6;
+
+    double a = passes_per_sec([&] { return check_pass(byte_fits); }) * per_pass;
+    double c = passes_per_sec([&] { return check_pass(bit_fits); }) * per_pass;
+    printf("collision check: %s\n", agree ? "ok" : "MISMATCH");
+    printf("can_place  %7.1f -> %7.1f M checks/s  (x%.1f)\n", a, c, c / a);
+
+    a = passes_per_sec([&] { return drop_pass(byte_fits); }) * per_pass;
+    c = passes_per_sec([&] { return drop_pass(bit_fits); }) * per_pass;
+    printf("ghost drop %7.1f -> %7.1f M drops/s   (x%.1f)\n", a, c, c / a);
+    double d = passes_per_sec(drop_distance_pass) * per_pass;
+    printf("  from column tops    %7.1f M drops/s   (x%.1f)\n", d, d / a);
+    return agree ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+#include <chrono>
+#include <string.h>
+#include "st7735.h"
+#include "st7735_dl.h"
+#include "st7735_host.h"
+
+// Renders a frame shaped like the game screen through the driver and the host
+// transport stand-in, and reports render cost and what went over the wire.
+// Built against the full framebuffer, in band mode (display_bench_band) and
+// over the PIO transport model (display_bench_pio).
+
+static const int CELL = 6;
+static const int FIELD_X = 2;
+static const int FIELD_Y = 3;
+
+// The scene goes either straight to the driver or into a display list
+struct Immediate
+{
+    void fill(int x, int y, int w, int h, uint16_t c) { ST7735_DrawRectFill(x, y, w, h, c); }
+    void frame(int x, int y, int w, int h, uint16_t c) { ST7735_DrawRect(x, y, w, h, c); }
+    void text(int x, int y, const char *s, uint16_t c) { ST7735_DrawString(x, y, s, Font_11x18, c); }
+};
+
+struct Recorder
+{
+    ST7735_DisplayList *dl;
+    void fill(int x, int y, int w, int h, uint16_t c) { ST7735_DL_RectFill(dl, x, y, w, h, c); }
+    void frame(int x, int y, int w, int h, uint16_t c) { ST7735_DL_Rect(dl, x, y, w, h, c); }
+    void text(int x, int y, const char *s, uint16_t c) { ST7735_DL_String(dl, x, y, s, &Font_11x18, c); }
+};
+
+template <class D>
+static void scene(D d, int frame)
+{
+    d.fill(0, 0, 160, 128, ST7735_BLACK);
+
+    d.fill(FIELD_X - 1, FIELD_Y + 5, 62, 1, ST7735_WHITE);
+    d.fill(FIELD_X - 1, FIELD_Y + 126, 62, 1, ST7735_WHITE);
+    d.fill(FIELD_X - 1, FIELD_Y + 6, 1, 120, ST7735_WHITE);
+    d.fill(FIELD_X + 60, FIELD_Y + 6, 1, 120, ST7735_WHITE);
+
+    // settled stack in the bottom rows
+    for (int r = 12; r < 21; r++)
+        for (int c = 0; c < 10; c++)
+            if ((r * 7 + c * 3) % 5)
+                d.fill(FIELD_X + c * CELL, FIELD_Y + r * CELL, CELL, CELL, 0x85a6);
+
+    // falling T piece and its ghost
+    int py = (frame / 4) % 10 + 1;
+    d.fill(FIELD_X + 4 * CELL, FIELD_Y + py * CELL, CELL, CELL, 0xaa54);
+    d.fill(FIELD_X + 3 * CELL, FIELD_Y + (py + 1) * CELL, 3 * CELL, CELL, 0xaa54);
+    for (int c = 3; c < 6; c++)
+        d.frame(FIELD_X + c * CELL, FIELD_Y + 11 * CELL, CELL - 1, CELL - 1, ST7735_WHITE);
+
+    // next queue
+    for (int i = 0; i < 4; i++)
+        d.fill(66 + 1, FIELD_Y + 8 + i * 22, 16, 8, 0x4a7f);
+
+    d.text(100, 45, "7", ST7735_WHITE);
+    d.text(93, 68, "60", ST7735_GREEN);
+}
+
+static void draw_scene(int frame)
+{
+    scene(Immediate(), frame);
+}
+
+static void record_scene(ST7735_DisplayList *dl, int frame)
+{
+    ST7735_DL_Begin(dl);
+    scene(Recorder{dl}, frame);
+}
+
+static ST7735_DisplayList dl;
+
+static void print_dl(const char *check, double record_us, double raster_us, int frames)
+{
+    ST7735_DLStats st = ST7735_DL_GetStats(&dl);
+    printf("display list: %s, %u cmds (%u merged, %u dropped), record %.2f + raster %.2f us/frame (host)\n",
+           check, (unsigned)st.commands, (unsigned)st.merged, (unsigned)st.dropped,
+           record_us / frames, raster_us / frames);
+}
+
+// 32-bit FNV-1a of the panel memory, to compare the two builds' output
+static uint32_t gram_hash()
+{
+    const uint16_t *gram = st7735_host_gram();
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < ST7735_HOST_GRAM_W * ST7735_HOST_GRAM_H; i++)
+        h = (h ^ gram[i]) * 16777619u;
+    return h;
+}
+
+#if ST7735_BAND_ROWS
+int main()
+{
+    const int frames = 2000;
+
+    ST7735_Init();
+
+    // every band has to reach the panel exactly once
+    ST7735_FirstBand();
+    do
+        draw_scene(0);
+    while (ST7735_NextBand());
+    ST7735_WaitIdle();
+    uint32_t bands = (ST7735_HEIGHT + ST7735_BAND_ROWS - 1) / ST7735_BAND_ROWS;
+    bool same = ST7735_GetFrameStats().regions == bands &&
+                ST7735_GetFrameStats().bytes == ST7735_WIDTH * ST7735_HEIGHT * 2 + bands * 11;
+    uint32_t hash = gram_hash();
+
+    // recorded once, replayed per band with the commands outside it culled
+    record_scene(&dl, 0);
+    ST7735_FirstBand();
+    do
+        ST7735_DL_Render(&dl);
+    while (ST7735_NextBand());
+    ST7735_WaitIdle();
+    bool dl_same = gram_hash() == hash;
+    uint32_t dl_culled = ST7735_DL_GetStats(&dl).culled;
+    uint32_t dl_replays = ST7735_DL_GetStats(&dl).commands * bands;
+
+    double record_us = 0, raster_us = 0;
+    for (int f = 0; f < frames; f++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        record_scene(&dl, f);
+        auto t1 = std::chrono::steady_clock::now();
+        record_us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+        ST7735_FirstBand();
+        do
+            ST7735_DL_Render(&dl);
+        while (ST7735_NextBand());
+        raster_us += ST7735_DL_GetStats(&dl).raster_us;
+    }
+    ST7735_WaitIdle();
+
+    st7735_host_reset_stats();
+    auto t0 = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++)
+    {
+        ST7735_FirstBand();
+        do
+            draw_scene(f);
+        while (ST7735_NextBand());
+    }
+    ST7735_WaitIdle();
+    auto t1 = std::chrono::steady_clock::now();
+
+    double bytes = (double)st7735_host_bytes() / frames;
+    printf("band check: %s, frame 0 hash %08x\n", same ? "ok" : "MISMATCH", (unsigned)hash);
+    printf("bands: %u x %d rows, %u B pixel RAM\n", (unsigned)bands, ST7735_BAND_ROWS,
+           (unsigned)(2 * ST7735_BAND_ROWS * ST7735_WIDTH * (ST7735_FB_INDEXED ? 1 : 2)));
+    printf("render: %.2f us/frame (host, all bands)\n",
+           std::chrono::duration<double, std::micro>(t1 - t0).count() / frames);
+    printf("wire:   %.0f bytes/frame, %.2f windows/frame, %.0f us/frame at 62.5 MHz\n",
+           bytes, (double)st7735_host_windows() / frames, bytes * 8 / 62.5);
+    print_dl(dl_same ? "ok" : "MISMATCH", record_us, raster_us, frames);
+    printf("culled: %u of %u command replays outside their band\n", (unsigned)dl_culled, (unsigned)dl_replays);
+    return same && dl_same ? 0 : 1;
+}
+#else
+int main()
+{
+    static uint16_t shown[16][ST7735_HOST_GRAM_W * ST7735_HOST_GRAM_H];
+    const int checked = 16;
+    const int frames = 2000;
+    uint32_t hash = 0;
+
+    ST7735_Init();
+
+    // partial presents must leave the same image as sending the whole frame
+    for (int f = 0; f < checked; f++)
+    {
+        draw_scene(f);
+        ST7735_UpdateAsync();
+        ST7735_WaitIdle();
+        memcpy(shown[f], st7735_host_gram(), sizeof(shown[f]));
+        if (f == 0)
+            hash = gram_hash();
+    }
+    bool same = true;
+    for (int f = 0; f < checked; f++)
+    {
+        ST7735_Invalidate();
+        draw_scene(f);
+        ST7735_Update();
+        same &= memcmp(shown[f], st7735_host_gram(), sizeof(shown[f])) == 0;
+    }
+
+    // the recorded scene has to rasterize to the same image
+    bool dl_same = true;
+    for (int f = 0; f < checked; f++)
+    {
+        record_scene(&dl, f);
+        ST7735_DL_Render(&dl);
+        ST7735_UpdateAsync();
+        ST7735_WaitIdle();
+        dl_same &= memcmp(shown[f], st7735_host_gram(), sizeof(shown[f])) == 0;
+    }
+
+    double record_us = 0, raster_us = 0;
+    for (int f = 0; f < frames; f++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        record_scene(&dl, f);
+        auto t1 = std::chrono::steady_clock::now();
+        record_us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+        ST7735_DL_Render(&dl);
+        raster_us += ST7735_DL_GetStats(&dl).raster_us;
+        ST7735_UpdateAsync();
+    }
+    ST7735_WaitIdle();
+
+    st7735_host_reset_stats();
+#ifdef ST7735_HOST_PIO
+    uint32_t words0 = st7735_host_pio_words();
+#endif
+    double render_us = 0;
+    uint32_t max_bytes = 0;
+    for (int f = 0; f < frames; f++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        draw_scene(f);
+        auto t1 = std::chrono::steady_clock::now();
+        render_us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+        ST7735_UpdateAsync();
+        if (ST7735_GetFrameStats().bytes > max_bytes)
+            max_bytes = ST7735_GetFrameStats().bytes;
+    }
+    ST7735_WaitIdle();
+
+    double bytes = (double)st7735_host_bytes() / frames;
+    double wire_us = bytes * 8 / 62.5;
+    printf("present check: %s, frame 0 hash %08x\n", same ? "ok" : "MISMATCH", (unsigned)hash);
+    printf("render: %.2f us/frame (host)\n", render_us / frames);
+    printf("wire:   %.0f bytes/frame (max %u), %.2f windows/frame, %.0f us/frame at 62.5 MHz\n",
+           bytes, (unsigned)max_bytes, (double)st7735_host_windows() / frames, wire_us);
+#ifdef ST7735_HOST_PIO
+    printf("pio:    %.0f TX FIFO words/frame\n", (double)(st7735_host_pio_words() - words0) / frames);
+#endif
+    print_dl(dl_same ? "ok" : "MISMATCH", record_us, raster_us, frames);
+    return same && dl_same ? 0 : 1;
+}
+#endif
@@ -0,0 +1,104 @@
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "game/tetris_eval.h"
+#include "game/tetris_queue.h"
+
+// Candidate boards/s of the batch evaluator (tetris_features_batch()) under
+// each kernel this CPU runs, against the scalar one. The boards are random
+// stacks with holes, overhangs and wells, laid out as the batch takes them
+// (row r of every board in one run); every kernel must give the same
+// features for every board.
+//
+//   eval_bench [-boards N] [-reps N] [-seed N]
+
+static void make_boards(std::vector<uint16_t> &rows, int n, uint32_t seed)
+{
+    uint32_t s = seed ? seed : 1;
+    for (int i = 0; i < n; i++)
+    {
+        int base = tetris_xorshift32(&s) % 16;
+        for (int c = 0; c < TETRIS_COLS; c++)
+        {
+            int h = base + (int)(tetris_xorshift32(&s) % 7) - 3;
+            h = (h < 0) ? 0 : (h > TETRIS_ROWS - 2) ? TETRIS_ROWS - 2 : h;
+            for (int r = TETRIS_ROWS - h; r < TETRIS_ROWS; r++)
+                if (r == TETRIS_ROWS - h || tetris_xorshift32(&s) % 8)
+                    rows[(size_t)r * n + i] |= 1u << (c + TETRIS_WALL);
+        }
+    }
+}
+
+static bool same(const TetrisFeatures &a, const TetrisFeatures &b)
+{
+    return a.height == b.height && a.holes == b.holes && a.bumpiness == b.bumpiness && a.wells == b.wells &&
+           a.transitions == b.transitions;
+}
+
+int main(int argc, char **argv)
+{
+    int n = 4096, reps = 200;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-boards") && i + 1 < argc)
+            n = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-reps") && i + 1 < argc)
+            reps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-seed") && i + 1 < argc)
+            seed = strtoul(argv[++i], NULL, 0);
+        else
+        {
+            fprintf(stderr, "usage: %s [-boards N] [-reps N] [-seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (n <= 0 || reps <= 0)
+        return 0;
+
+    std::vector<uint16_t> rows((size_t)TETRIS_ROWS * n, TETRIS_WALL_MASK);
+    make_boards(rows, n, seed);
+
+    // one board at a time, out of a TetrisBoard as the bot had it
+    std::vector<TetrisBoard> boards(n);
+    for (int i = 0; i < n; i++)
+    {
+        tetris_board_clear(&boards[i]);
+        for (int r = 0; r < TETRIS_ROWS; r++)
+            boards[i].rows[TETRIS_PAD + r] = rows[(size_t)r * n + i];
+    }
+    std::vector<TetrisFeatures> want(n), got(n);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int k = 0; k < reps; k++)
+        for (int i = 0; i < n; i++)
+            tetris_features(&boards[i], &want[i]);
+    double base_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    double total = (double)n * reps;
+    printf("%d boards x %d\n", n, reps);
+    printf("%-10s %8.2f M boards/s\n", "one-by-one", total / base_s / 1e6);
+
+    bool ok = true;
+    const TetrisEvalKernel kernels[] = {TETRIS_EVAL_SCALAR, TETRIS_EVAL_SWAR, TETRIS_EVAL_SSE2, TETRIS_EVAL_AVX2};
+    for (TetrisEvalKernel kernel : kernels)
+    {
+        if (!tetris_eval_kernel_supported(kernel))
+        {
+            printf("%-10s not supported here\n", tetris_eval_kernel_name(kernel));
+            continue;
+        }
+        memset(got.data(), 0, n * sizeof(TetrisFeatures));
+        t0 = std::chrono::steady_clock::now();
+        for (int k = 0; k < reps; k++)
+            tetris_features_batch(rows.data(), n, n, got.data(), kernel);
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        int bad = 0;
+        for (int i = 0; i < n; i++)
+            bad += !same(got[i], want[i]);
+        printf("%-10s %8.2f M boards/s  x%5.2f%s\n", tetris_eval_kernel_name(kernel), total / s / 1e6, base_s / s,
+               bad ? "  MISMATCH" : "");
+        ok &= !bad;
+    }
+    return ok ? 0 : 1;
+}
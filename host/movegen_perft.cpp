@@ -0,0 +1,156 @@
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game/tetris_movegen.h"
+
+// Perft for the placement generator: on fixed boards and piece sequences,
+// count every sequence of placements `depth` pieces deep (each locked, with
+// its lines cleared, before the next piece is placed), and how many of the
+// last placements are tucks and spins, and time it. The counts only change
+// when the generator's rules do, so they double as a regression check;
+// placements/s and nodes/s (positions the search expanded) track its speed.
+//
+//   movegen_perft [-depth N]
+
+struct Position
+{
+    const char *name;
+    const char *queue;
+    const char *rows[TETRIS_ROWS]; // bottom rows of the field, top first; 'X' = filled
+};
+
+static const Position positions[] = {
+    {"empty", "TIOLJSZ", {NULL}},
+    // T slot under a roof: reachable only by a turn
+    {"tsd", "TSZLJOI",
+     {
+         "XX........",
+         "X...XXXXXX",
+         "XX.XXXXXXX",
+         NULL,
+     }},
+    // caves and overhangs everywhere
+    {"caves", "JLTISZO",
+     {
+         "..XX......",
+         "..X....XXX",
+         "X.X.XX.XXX",
+         "XX........",
+         "XX........",
+         "X.XXXXX.XX",
+         NULL,
+     }},
+    // stacked high: few moves left near the top
+    {"tall", "ISZTOJL",
+     {
+         "....XX....",
+         "X...XXX..X",
+         "XX.XXXX.XX",
+         "XX.XXXXXX.",
+         "XX........",
+         "XX.XXXXXXX",
+         "X.XXXXXXXX",
+         "XX.XXXXXXX",
+         "XX........",
+         "XX........",
+         "XX.XXXXXXX",
+         "XX........",
+         NULL,
+     }},
+};
+
+static const int MAX_DEPTH = 7;
+static TetrisMoveGen gens[MAX_DEPTH];
+
+static int piece_of(char c)
+{
+    const char *names = "IOTSZJL";
+    return (int)(strchr(names, c) - names);
+}
+
+static void load(TetrisBoard *b, const Position &p)
+{
+    tetris_board_clear(b);
+    int n = 0;
+    while (n < TETRIS_ROWS && p.rows[n])
+        n++;
+    for (int i = 0; i < n; i++)
+        for (int c = 0; c < TETRIS_COLS; c++)
+            if (p.rows[i][c] == 'X')
+                b->rows[TETRIS_PAD + TETRIS_ROWS - n + i] |= 1u << (c + TETRIS_WALL);
+    tetris_update_tops(b);
+}
+
+struct Count
+{
+    uint64_t leaves, tucks, spins;
+};
+
+static void perft(const TetrisBoard *b, const char *queue, int depth, Count *c)
+{
+    TetrisMoveGen *g = &gens[depth - 1];
+    int t = piece_of(*queue);
+    int n = tetris_movegen(g, b, t, 0, TETRIS_TABLES.spawn_x[t], 0);
+    for (int i = 0; i < n; i++)
+    {
+        const TetrisPlacement &p = g->place[i];
+        if (depth == 1)
+        {
+            c->leaves++;
+            c->tucks += (p.flags & TETRIS_PLACE_TUCK) != 0;
+            c->spins += (p.flags & TETRIS_PLACE_SPIN) != 0;
+            continue;
+        }
+        TetrisBoard next = *b;
+        tetris_lock(&next, t, p.r, p.x, p.y);
+        tetris_clear_lines(&next, p.y, NULL);
+        perft(&next, queue + 1, depth - 1, c);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int max_depth = 3;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-depth") && i + 1 < argc)
+            max_depth = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [-depth N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (max_depth < 1 || max_depth > MAX_DEPTH)
+    {
+        fprintf(stderr, "depth 1..%d\n", MAX_DEPTH);
+        return 2;
+    }
+
+    printf("%-8s %5s %12s %10s %8s %12s %9s %11s %11s\n", "board", "depth", "placements", "tucks", "spins",
+           "nodes", "ms", "places/s", "nodes/s");
+    for (const Position &p : positions)
+    {
+        TetrisBoard b;
+        load(&b, p);
+        for (int depth = 1; depth <= max_depth; depth++)
+        {
+            uint64_t nodes0 = 0;
+            for (const TetrisMoveGen &g : gens)
+                nodes0 += g.nodes;
+            auto t0 = std::chrono::steady_clock::now();
+            Count c = {0, 0, 0};
+            perft(&b, p.queue, depth, &c);
+            double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            uint64_t nodes = 0;
+            for (const TetrisMoveGen &g : gens)
+                nodes += g.nodes;
+            nodes -= nodes0;
+            printf("%-8s %5d %12llu %10llu %8llu %12llu %9.2f %11.0f %11.0f\n", p.name, depth,
+                   (unsigned long long)c.leaves, (unsigned long long)c.tucks, (unsigned long long)c.spins,
+                   (unsigned long long)nodes, s * 1e3, c.leaves / s, nodes / s);
+        }
+    }
+    return 0;
+}
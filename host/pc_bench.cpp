@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game/tetris_bot.h"
+#include "game/tetris_pc.h"
+
+// Perfect clear queries (game/tetris_pc.h) on the first bag of many seeds:
+// the empty field, the first piece in play, nothing held, and the pieces
+// after it as the game deals them (-pieces of them, the preview and beyond;
+// -visible stops at the preview, as the in-game indicator does). Each query
+// runs with the pruning and the memo on, then with each turned off, up to
+// -nodes states; every solution found is played out through the game's own
+// moves and must leave the field empty.
+//
+//   pc_bench [-queries N] [-seed N] [-lines N] [-pieces N] [-visible] [-nodes N] [-memo-kb N]
+
+struct Mode
+{
+    const char *name;
+    unsigned flags;
+};
+
+static const Mode MODES[] = {
+    {"prune+memo", TETRIS_PC_PRUNE | TETRIS_PC_MEMO},
+    {"prune", TETRIS_PC_PRUNE},
+    {"memo", TETRIS_PC_MEMO},
+    {"neither", 0},
+};
+
+static TetrisPCSolver pc;
+static TetrisMoveGen gen;
+
+// True when placement a of piece t covers the cells of b
+static bool same_cells(int t, const TetrisPlacement *a, const TetrisPiece *b)
+{
+    uint8_t ea = TETRIS_TABLES.extent[t][a->r], eb = TETRIS_TABLES.extent[t][b->r];
+    return TETRIS_TABLES.shape[t][a->r] == TETRIS_TABLES.shape[t][b->r] &&
+           a->x + (ea & 3) == b->x + (eb & 3) && a->y + (ea >> 2 & 3) == b->y + (eb >> 2 & 3);
+}
+
+// Plays sol from the start of game seed; true when the field ends empty
+static bool replay(uint32_t seed, const TetrisPCSolution *sol)
+{
+    static TetrisGame g;
+    tetris_game_init(&g, seed, 0);
+    for (int i = 0; i < sol->count; i++)
+    {
+        const TetrisPCStep &step = sol->step[i];
+        TetrisPiece start = g.cur;
+        if (step.hold)
+        {
+            start.t = step.piece.t;
+            start.r = 0;
+            start.x = TETRIS_TABLES.spawn_x[start.t];
+            start.y = 0;
+        }
+        // the same cells may come as another rotation (S, Z, I, O)
+        int n = tetris_movegen(&gen, &g.board, start.t, start.r, start.x, start.y);
+        int k = 0;
+        while (k < n && !same_cells(step.piece.t, &gen.place[k], &step.piece))
+            k++;
+        if (k == n)
+            return false;
+        TetrisPlan plan = {};
+        plan.hold = step.hold;
+        plan.target = step.piece;
+        plan.count = tetris_movegen_path(&gen, k, plan.moves, TETRIS_BOT_MAX_MOVES);
+        tetris_bot_play(&g, &plan);
+        if (g.top_outs)
+            return false;
+    }
+    for (int r = 0; r < TETRIS_ROWS; r++)
+        if (!tetris_row_empty(&g.board, r))
+            return false;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t queries = 200, seed = 1, max_nodes = 200000;
+    int lines = 4, pieces = 10;
+    size_t memo_kb = 1024;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-queries") && i + 1 < argc)
+            queries = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-seed") && i + 1 < argc)
+            seed = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-lines") && i + 1 < argc)
+            lines = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-pieces") && i + 1 < argc)
+            pieces = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-visible"))
+            pieces = TETRIS_PREVIEW;
+        else if (!strcmp(argv[i], "-nodes") && i + 1 < argc)
+            max_nodes = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-memo-kb") && i + 1 < argc)
+            memo_kb = strtoull(argv[++i], NULL, 0);
+        else
+        {
+            fprintf(stderr,
+                    "usage: %s [-queries N] [-seed N] [-lines N] [-pieces N] [-visible] [-nodes N] [-memo-kb N]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (pieces < 0 || pieces >= TETRIS_PC_MAX_PIECES)
+        pieces = TETRIS_PC_MAX_PIECES - 1;
+
+    TetrisTT memo;
+    TetrisTTBucket *buckets = (TetrisTTBucket *)aligned_alloc(sizeof(TetrisTTBucket), memo_kb * 1024);
+    if (!buckets)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    tetris_tt_init(&memo, buckets, memo_kb * 1024);
+    tetris_pc_init(&pc);
+    tetris_pc_set_memo(&pc, &memo);
+    pc.max_nodes = max_nodes;
+
+    printf("%u queries from seed %u: empty field, current piece + %d, at most %d lines, %u nodes each\n",
+           (unsigned)queries, (unsigned)seed, pieces, lines, (unsigned)max_nodes);
+    printf("%-11s %6s %6s %7s %9s %9s %9s %12s %10s %10s\n", "", "found", "none", "gave up", "avg ms", "median ms",
+           "worst ms", "nodes/query", "pruned", "memo hits");
+    for (const Mode &mode : MODES)
+    {
+        pc.flags = mode.flags;
+        pc.nodes = pc.pruned = pc.memo_hits = 0;
+        unsigned count[3] = {0, 0, 0}, bad = 0;
+        double total = 0;
+        std::vector<double> times;
+        for (uint32_t q = 0; q < queries; q++)
+        {
+            static TetrisGame g;
+            tetris_game_init(&g, seed + q, 0);
+            TetrisQueue deal = g.queue;
+            int next[TETRIS_PC_MAX_PIECES];
+            for (int i = 0; i < pieces; i++)
+                next[i] = tetris_queue_pop(&deal);
+
+            TetrisPCSolution sol;
+            auto t0 = std::chrono::steady_clock::now();
+            TetrisPCResult r = tetris_pc_solve(&pc, &g.board, &g.cur, -1, true, next, pieces, lines, &sol);
+            double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            total += s;
+            times.push_back(s);
+            count[r]++;
+            if (r == TETRIS_PC_FOUND && !replay(seed + q, &sol))
+                bad++;
+        }
+        std::sort(times.begin(), times.end());
+        printf("%-11s %6u %6u %7u %9.3f %9.3f %9.3f %12.0f %10llu %10llu\n", mode.name, count[TETRIS_PC_FOUND],
+               count[TETRIS_PC_NONE], count[TETRIS_PC_GAVE_UP], total / queries * 1e3, times[queries / 2] * 1e3,
+               times.back() * 1e3,
+               (double)pc.nodes / queries, (unsigned long long)pc.pruned, (unsigned long long)pc.memo_hits);
+        if (bad)
+        {
+            printf("%u solutions did not clear the field\n", bad);
+            return 1;
+        }
+    }
+    free(buckets);
+    return 0;
+}
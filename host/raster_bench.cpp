@@ -0,0 +1,108 @@
+#include <chrono>
+#include <functional>
+#include <string.h>
+#include "st7735.h"
+#include "st7735_host.h"
+#include "images.h"
+
+// Pixels/sec of the span raster paths against the per-pixel path they
+// replaced (ST7735_DrawPixel goes through fb_set_pixel one pixel at a time).
+
+static const int W = ST7735_HEIGHT; // logical size in the game's rotation
+static const int H = ST7735_WIDTH;
+
+static void pixel_rect(int x, int y, int w, int h, uint16_t color)
+{
+    for (int yy = 0; yy < h; yy++)
+        for (int xx = 0; xx < w; xx++)
+            ST7735_DrawPixel(x + xx, y + yy, color);
+}
+
+static void pixel_image(int x, int y, int w, int h, const uint16_t *data)
+{
+    for (int yy = 0; yy < h; yy++)
+        for (int xx = 0; xx < w; xx++)
+            ST7735_DrawPixel(x + xx, y + yy, data[yy * w + xx]);
+}
+
+static double mpixels_per_sec(uint32_t pixels_per_call, const std::function<void()> &fn)
+{
+    uint32_t calls = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    double elapsed;
+    do
+    {
+        for (int i = 0; i < 64; i++)
+            fn();
+        calls += 64;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    } while (elapsed < 0.2);
+    return (double)pixels_per_call * calls / elapsed / 1e6;
+}
+
+static void report(const char *name, uint32_t pixels, const std::function<void()> &per_pixel,
+                   const std::function<void()> &span)
+{
+    double a = mpixels_per_sec(pixels, per_pixel);
+    double b = mpixels_per_sec(pixels, span);
+    printf("%-22s %8.1f -> %8.1f Mpx/s  (x%.1f)\n", name, a, b, b / a);
+}
+
+// both ways of drawing the scene must leave the same panel image
+static bool same_output(const std::function<void()> &per_pixel, const std::function<void()> &span)
+{
+    static uint16_t expected[ST7735_HOST_GRAM_W * ST7735_HOST_GRAM_H];
+    ST7735_FillScreen(0x1234);
+    per_pixel();
+    ST7735_Invalidate();
+    ST7735_Update();
+    memcpy(expected, st7735_host_gram(), sizeof(expected));
+    ST7735_FillScreen(0x1234);
+    span();
+    ST7735_Invalidate();
+    ST7735_Update();
+    return memcmp(expected, st7735_host_gram(), sizeof(expected)) == 0;
+}
+
+int main()
+{
+    ST7735_Init();
+
+    bool ok = same_output(
+        [] {
+            pixel_rect(0, 0, W, H, ST7735_BLACK);
+            pixel_rect(-3, 5, 20, 9, ST7735_RED);
+            pixel_rect(150, 120, 30, 30, ST7735_GREEN);
+            pixel_rect(7, 0, 1, 128, ST7735_WHITE);
+            pixel_rect(0, 9, 160, 1, ST7735_CYAN);
+            pixel_image(0, 0, CAT_FARMER_WIDTH, 40, cat_farmer);
+        },
+        [] {
+            ST7735_FillScreen(ST7735_BLACK);
+            ST7735_DrawFastHLine(-3, 5, 20, ST7735_RED);
+            for (int i = 6; i < 14; i++)
+                ST7735_DrawFastHLine(-3, i, 20, ST7735_RED);
+            ST7735_DrawRectFill(150, 120, 30, 30, ST7735_GREEN);
+            ST7735_DrawFastVLine(7, 0, 128, ST7735_WHITE);
+            ST7735_DrawFastHLine(0, 9, 160, ST7735_CYAN);
+            ST7735_DrawImage(0, 0, CAT_FARMER_WIDTH, 40, cat_farmer);
+        });
+    printf("span output matches per-pixel: %s\n", ok ? "ok" : "MISMATCH");
+
+    report("FillScreen", W * H,
+           [] { pixel_rect(0, 0, W, H, ST7735_BLACK); },
+           [] { ST7735_FillScreen(ST7735_BLACK); });
+    report("RectFill 6x6 cell", 36,
+           [] { pixel_rect(20, 30, 6, 6, 0xaa54); },
+           [] { ST7735_DrawRectFill(20, 30, 6, 6, 0xaa54); });
+    report("FastHLine 60", 60,
+           [] { pixel_rect(2, 40, 60, 1, ST7735_WHITE); },
+           [] { ST7735_DrawFastHLine(2, 40, 60, ST7735_WHITE); });
+    report("FastVLine 120", 120,
+           [] { pixel_rect(2, 4, 1, 120, ST7735_WHITE); },
+           [] { ST7735_DrawFastVLine(2, 4, 120, ST7735_WHITE); });
+    report("DrawImage 160x128", W * H,
+           [] { pixel_image(0, 0, CAT_FARMER_WIDTH, CAT_FARMER_HEIGHT, cat_farmer); },
+           [] { ST7735_DrawImage(0, 0, CAT_FARMER_WIDTH, CAT_FARMER_HEIGHT, cat_farmer); });
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+#ifndef SIM_INPUT_H_
+#define SIM_INPUT_H_
+
+#include <stdint.h>
+#include "game/tetris_queue.h"
+
+// Scripted input for headless games: holds a random button or two for a
+// random time, lets go, and so on. Pause is left out so the game keeps
+// running. Deterministic per seed.
+
+struct SimMasher
+{
+    uint32_t rng;
+    uint64_t next_us; // time of the next input change
+    bool holding;     // the change at next_us presses (false) or releases (true)
+};
+
+static inline void sim_masher_init(SimMasher *m, uint32_t seed)
+{
+    m->rng = seed ^ 0x9E3779B9;
+    m->next_us = 0;
+    m->holding = false;
+}
+
+// Next input change: its time and the buttons held from then on
+static inline void sim_masher_next(SimMasher *m, uint64_t *us, uint32_t *buttons)
+{
+    *us = m->next_us;
+    uint32_t r = tetris_xorshift32(&m->rng);
+    if (!m->holding)
+    {
+        *buttons = (1u << (r % 7)) | ((r >> 8) % 4 == 0 ? 1u << ((r >> 12) % 7) : 0);
+        m->next_us += 20000 + (r >> 16) % 200000;
+    }
+    else
+    {
+        *buttons = 0;
+        m->next_us += 5000 + r % 40000;
+    }
+    m->holding = !m->holding;
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef ST7735_HOST_H_
+#define ST7735_HOST_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Inspection hooks of the host transports: the SPI stand-in
+// (st7735_port_host.cpp) and the PIO model (st7735_port_pio_host.cpp). Both
+// feed a panel decoder (st7735_host_panel.cpp) that handles CASET/RASET/RAMWR
+// like the controller does and keeps the resulting panel memory, so what
+// reached the "display" can be checked.
+
+#define ST7735_HOST_GRAM_W 128
+#define ST7735_HOST_GRAM_H 160
+
+// Panel memory in wire format (the 16-bit words as clocked out), row-major
+const uint16_t *st7735_host_gram(void);
+
+// Bytes clocked out since the last reset: commands, parameters and pixels
+uint32_t st7735_host_bytes(void);
+uint32_t st7735_host_windows(void);
+void st7735_host_reset_stats(void);
+
+// Panel side of the link, called by the transports
+void st7735_host_panel_reset(void);
+void st7735_host_panel_byte(bool dc, uint8_t byte);
+
+// PIO model only: TX FIFO words pushed since st7735_port_init()
+uint32_t st7735_host_pio_words(void);
+
+#endif
@@ -0,0 +1,105 @@
+#include <string.h>
+#include "st7735.h"
+#include "st7735_host.h"
+
+// The controller side of the link: decodes the byte stream the way the
+// ST7735 does (CASET/RASET/RAMWR) into a simulated panel memory. Both host
+// transports feed it, the SPI stand-in byte by byte and the PIO model from
+// the bits its state machine would clock out.
+
+static uint16_t gram[ST7735_HOST_GRAM_W * ST7735_HOST_GRAM_H];
+static uint8_t win_x0, win_y0, win_x1, win_y1;
+static uint8_t cur_x, cur_y;
+static uint8_t command;
+static uint8_t params[4];
+static uint8_t param_count;
+static uint8_t pixel_hi;
+static uint32_t bytes_sent;
+static uint32_t windows_set;
+
+static void gram_write(uint16_t px)
+{
+    if (cur_x < ST7735_HOST_GRAM_W && cur_y < ST7735_HOST_GRAM_H)
+        gram[cur_y * ST7735_HOST_GRAM_W + cur_x] = px;
+    if (cur_x < win_x1)
+    {
+        cur_x++;
+    }
+    else
+    {
+        cur_x = win_x0;
+        cur_y = (cur_y < win_y1) ? cur_y + 1 : win_y0;
+    }
+}
+
+void st7735_host_panel_reset(void)
+{
+    memset(gram, 0, sizeof(gram));
+    win_x0 = win_y0 = 0;
+    win_x1 = ST7735_HOST_GRAM_W - 1;
+    win_y1 = ST7735_HOST_GRAM_H - 1;
+    command = ST7735_NOP;
+    param_count = 0;
+    st7735_host_reset_stats();
+}
+
+void st7735_host_panel_byte(bool dc, uint8_t byte)
+{
+    bytes_sent++;
+    if (!dc)
+    {
+        command = byte;
+        param_count = 0;
+        if (command == ST7735_RAMWR)
+        {
+            cur_x = win_x0;
+            cur_y = win_y0;
+            windows_set++;
+        }
+        return;
+    }
+
+    if (command == ST7735_RAMWR)
+    {
+        if (param_count++ & 1)
+            gram_write((uint16_t)(pixel_hi << 8) | byte);
+        else
+            pixel_hi = byte;
+        return;
+    }
+    if (param_count < sizeof(params))
+        params[param_count] = byte;
+    if (++param_count != 4)
+        return;
+    if (command == ST7735_CASET)
+    {
+        win_x0 = params[1];
+        win_x1 = params[3];
+    }
+    else if (command == ST7735_RASET)
+    {
+        win_y0 = params[1];
+        win_y1 = params[3];
+    }
+}
+
+const uint16_t *st7735_host_gram(void)
+{
+    return gram;
+}
+
+uint32_t st7735_host_bytes(void)
+{
+    return bytes_sent;
+}
+
+uint32_t st7735_host_windows(void)
+{
+    return windows_set;
+}
+
+void st7735_host_reset_stats(void)
+{
+    bytes_sent = 0;
+    windows_set = 0;
+}
@@ -0,0 +1,70 @@
+#include <chrono>
+#include "st7735.h"
+#include "st7735_port.h"
+#include "st7735_host.h"
+
+// a started transfer completes on the next st7735_port_poll(), standing in for the DMA IRQ
+static const uint16_t *pending_pixels;
+static size_t pending_count;
+static st7735_port_done_t pending_done;
+
+void st7735_port_init(void)
+{
+    st7735_host_panel_reset();
+    pending_pixels = NULL;
+    pending_count = 0;
+    pending_done = NULL;
+}
+
+void st7735_port_reset(void) {}
+void st7735_port_delay_ms(uint32_t ms) { (void)ms; }
+void st7735_port_backlight(bool on) { (void)on; }
+
+void st7735_port_command(uint8_t cmd, const uint8_t *args, size_t nargs)
+{
+    st7735_host_panel_byte(false, cmd);
+    for (size_t i = 0; i < nargs; ++i)
+        st7735_host_panel_byte(true, args[i]);
+}
+
+void st7735_port_window(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
+{
+    uint8_t dataCol[] = {0x00, x0, 0x00, x1};
+    uint8_t dataRow[] = {0x00, y0, 0x00, y1};
+    st7735_port_command(ST7735_CASET, dataCol, sizeof(dataCol));
+    st7735_port_command(ST7735_RASET, dataRow, sizeof(dataRow));
+    st7735_port_command(ST7735_RAMWR, NULL, 0);
+}
+
+void st7735_port_pixels_async(const uint16_t *pixels, size_t count, st7735_port_done_t done)
+{
+    pending_pixels = pixels;
+    pending_count = count;
+    pending_done = done;
+}
+
+void st7735_port_poll(void)
+{
+    if (!pending_done && !pending_count)
+        return;
+    const uint16_t *px = pending_pixels;
+    size_t n = pending_count;
+    st7735_port_done_t done = pending_done;
+    pending_pixels = NULL;
+    pending_count = 0;
+    pending_done = NULL;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        st7735_host_panel_byte(true, px[i] >> 8);
+        st7735_host_panel_byte(true, px[i] & 0xFF);
+    }
+    if (done)
+        done();
+}
+
+uint32_t st7735_port_time_us(void)
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,131 @@
+#include <chrono>
+#include "st7735.h"
+#include "st7735_port.h"
+#include "st7735_pio.h"
+#include "st7735_host.h"
+
+// Host model of the PIO transport (drivers/st7735_port_pio.cpp): the port
+// encodes FIFO words exactly like the device does, and a software copy of the
+// st7735_lcd program turns them back into the DC-tagged bytes it would clock
+// out. A wrong header or packing shows up as a wrong panel image.
+
+// program state between FIFO words
+static bool sm_busy;      // header seen, CS low
+static bool sm_dc;
+static bool sm_pad;
+static uint32_t sm_bits;  // still to clock out in this transfer
+static uint8_t sm_byte;
+static uint8_t sm_byte_bits;
+static uint32_t fifo_words;
+
+static const uint16_t *pending_pixels;
+static size_t pending_count;
+static st7735_port_done_t pending_done;
+
+static void sm_push(uint32_t word)
+{
+    uint16_t unit = word >> 16;
+    fifo_words++;
+    if (!sm_busy)
+    {
+        sm_dc = unit >> 15;
+        sm_pad = (unit >> 14) & 1;
+        sm_bits = (unit & 0x3FFF) + 1;
+        sm_busy = true;
+        return;
+    }
+
+    int n = (sm_bits < 16) ? sm_bits : 16;
+    for (int i = 0; i < n; ++i)
+    {
+        sm_byte = (sm_byte << 1) | ((unit >> (15 - i)) & 1);
+        if (++sm_byte_bits == 8)
+        {
+            st7735_host_panel_byte(sm_dc, sm_byte);
+            sm_byte_bits = 0;
+        }
+    }
+    sm_bits -= n;
+    // a padded transfer ends on 8 bits, the rest of its last unit is dropped
+    if (!sm_bits)
+        sm_busy = false;
+}
+
+uint32_t st7735_host_pio_words(void)
+{
+    return fifo_words;
+}
+
+void st7735_port_init(void)
+{
+    st7735_host_panel_reset();
+    sm_busy = false;
+    sm_byte_bits = 0;
+    fifo_words = 0;
+    pending_pixels = NULL;
+    pending_count = 0;
+    pending_done = NULL;
+}
+
+void st7735_port_reset(void) {}
+void st7735_port_delay_ms(uint32_t ms) { (void)ms; }
+void st7735_port_backlight(bool on) { (void)on; }
+
+void st7735_port_command(uint8_t cmd, const uint8_t *args, size_t nargs)
+{
+    sm_push(st7735_pio_header(false, 8));
+    sm_push((uint32_t)cmd << 24);
+    if (!nargs)
+        return;
+    sm_push(st7735_pio_header(true, nargs * 8));
+    for (size_t i = 0; i < nargs; i += 2)
+        sm_push(st7735_pio_bytes(args, i, nargs));
+}
+
+void st7735_port_window(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1)
+{
+    uint8_t dataCol[] = {0x00, x0, 0x00, x1};
+    uint8_t dataRow[] = {0x00, y0, 0x00, y1};
+    st7735_port_command(ST7735_CASET, dataCol, sizeof(dataCol));
+    st7735_port_command(ST7735_RASET, dataRow, sizeof(dataRow));
+    st7735_port_command(ST7735_RAMWR, NULL, 0);
+}
+
+void st7735_port_pixels_async(const uint16_t *pixels, size_t count, st7735_port_done_t done)
+{
+    pending_pixels = pixels;
+    pending_count = count;
+    pending_done = done;
+}
+
+// Completes a started transfer, in chunks like the DMA IRQ chain; a 16-bit
+// DMA write replicates the halfword, so the pixel lands in the upper half
+void st7735_port_poll(void)
+{
+    if (!pending_done && !pending_count)
+        return;
+    const uint16_t *px = pending_pixels;
+    size_t left = pending_count;
+    st7735_port_done_t done = pending_done;
+    pending_pixels = NULL;
+    pending_count = 0;
+    pending_done = NULL;
+
+    while (left)
+    {
+        size_t n = (left < ST7735_PIO_MAX_PIXELS) ? left : ST7735_PIO_MAX_PIXELS;
+        sm_push(st7735_pio_header(true, n * 16));
+        for (size_t i = 0; i < n; ++i)
+            sm_push((uint32_t)px[i] * 0x10001u);
+        px += n;
+        left -= n;
+    }
+    if (done)
+        done();
+}
+
+uint32_t st7735_port_time_us(void)
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
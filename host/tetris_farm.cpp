@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "game/tetris_game.h"
+#include "sim_input.h"
+#include "work_steal.h"
+
+// Many independent headless games across all cores. Each game has its own
+// seed (bag order and input) and plays until it tops out or hits the time
+// cap; games are tasks on a work-stealing pool, since their length varies a
+// lot. Results go into a per-game slot, so the summary and its hash do not
+// depend on the thread count.
+//
+//   tetris_farm [-games N] [-threads N] [-seed N] [-ms N] [-tick-us N]
+
+struct Result
+{
+    uint32_t pieces;
+    int score; // of the first game, or of the game in progress at the cap
+    int lines;
+    uint64_t play_us;
+    uint32_t hash;
+};
+
+static Result play(uint32_t seed, uint64_t cap_us, uint64_t tick_us)
+{
+    TetrisGame g;
+    tetris_game_init(&g, seed, 0);
+    SimMasher m;
+    sim_masher_init(&m, seed);
+
+    uint32_t buttons = 0;
+    uint64_t now = 0;
+    int lines = 0;
+    for (; now <= cap_us && !g.top_outs; now += tick_us)
+    {
+        while (m.next_us <= now)
+        {
+            uint64_t us;
+            sim_masher_next(&m, &us, &buttons);
+        }
+        tetris_game_step(&g, buttons, now);
+        lines = g.lines ? g.lines : lines;
+    }
+    return Result{g.pieces, g.top_outs ? g.final_score : g.score, lines, now, tetris_game_hash(&g)};
+}
+
+template <class T>
+static void print_spread(const char *name, std::vector<T> v)
+{
+    std::sort(v.begin(), v.end());
+    double sum = 0;
+    for (T x : v)
+        sum += x;
+    size_t n = v.size();
+    printf("%-12s mean %9.1f  min %7lld  p10 %7lld  p50 %7lld  p90 %7lld  max %7lld\n", name, sum / n,
+           (long long)v[0], (long long)v[n / 10], (long long)v[n / 2], (long long)v[n * 9 / 10],
+           (long long)v[n - 1]);
+}
+
+int main(int argc, char **argv)
+{
+    size_t games = 4096;
+    unsigned threads = 0;
+    uint32_t seed = 1;
+    uint64_t cap_us = 600 * 1000000ull;
+    uint64_t tick_us = 1000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-games") && i + 1 < argc)
+            games = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-threads") && i + 1 < argc)
+            threads = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-seed") && i + 1 < argc)
+            seed = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-ms") && i + 1 < argc)
+            cap_us = strtoull(argv[++i], NULL, 0) * 1000;
+        else if (!strcmp(argv[i], "-tick-us") && i + 1 < argc)
+            tick_us = strtoull(argv[++i], NULL, 0);
+        else
+        {
+            fprintf(stderr, "usage: %s [-games N] [-threads N] [-seed N] [-ms N] [-tick-us N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!games)
+        return 0;
+
+    WorkStealPool pool(threads);
+    std::vector<Result> results(games);
+
+    auto t0 = std::chrono::steady_clock::now();
+    pool.run(games, [&](size_t i, unsigned) {
+        // game seeds spread with a multiplicative hash; 0 would stall xorshift
+        uint32_t s = (seed + (uint32_t)i) * 2654435761u;
+        results[i] = play(s ? s : 1, cap_us, tick_us);
+    });
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    uint64_t pieces = 0;
+    double play_s = 0;
+    uint32_t hash = 2166136261u;
+    std::vector<int> scores, lines;
+    std::vector<uint32_t> piece_counts;
+    for (const Result &r : results)
+    {
+        pieces += r.pieces;
+        play_s += r.play_us / 1e6;
+        hash = (hash ^ r.hash) * 16777619u;
+        scores.push_back(r.score);
+        lines.push_back(r.lines);
+        piece_counts.push_back(r.pieces);
+    }
+
+    printf("%zu games on %u threads in %.3f s (%llu steals)\n", games, pool.size(), wall,
+           (unsigned long long)pool.steals());
+    printf("%.0f games/s, %.2f M pieces/s, x%.0f real time\n", games / wall, pieces / wall / 1e6, play_s / wall);
+    print_spread("score", scores);
+    print_spread("lines", lines);
+    print_spread("pieces", piece_counts);
+    printf("results hash %08x\n", (unsigned)hash);
+    return 0;
+}
@@ -0,0 +1,276 @@
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game/tetris_game.h"
+#include "bot_pool.h"
+#include "sim_input.h"
+
+// Headless game: the rules of game/tetris_game.cpp against a virtual clock,
+// fed from an input trace or from scripted random presses. Runs as fast as
+// the host allows and prints the final state hash, so two builds (or a
+// change to the rules) can be compared by replaying the same trace.
+//
+//   tetris_sim [-seed N] [-ms N] [-tick-us N] [-record FILE] [TRACE]
+//   tetris_sim -bot [-seed N] [-pieces N] [-beam N] [-depth N] [-threads N] [-budget-us N] [-tt-kb N]
+//                [-rollouts N] [-horizon N]
+//
+// A trace is text, one line per input change: "<time_us> <buttons>", with
+// buttons the TETRIS_BTN_* mask in hex; lines starting with '#' are skipped.
+// The game seed goes in a "# seed N" line, the end of play in "# end US"
+// (default: the last event). Without a trace the input comes from a
+// button-masher seeded like the game; -record writes it out as a trace.
+//
+// With -bot, game/tetris_bot.h plays instead, one piece per tick, and the
+// run reports how it played, placements searched per second and how long
+// each decision took. Its search runs on -threads workers, against a
+// deadline of the piece's lock time (game time, taken as real time) or
+// -budget-us, whichever comes first, with a transposition table of -tt-kb
+// (0 = none). -rollouts N plays N Monte Carlo rollouts per decision,
+// -horizon pieces past the preview each, and reports how many it got
+// through per second.
+
+struct Event
+{
+    uint64_t us;
+    uint32_t buttons;
+};
+
+static Event *events;
+static size_t event_count, event_cap;
+
+static void add_event(uint64_t us, uint32_t buttons)
+{
+    if (event_count == event_cap)
+    {
+        event_cap = event_cap ? event_cap * 2 : 1024;
+        events = (Event *)realloc(events, event_cap * sizeof(Event));
+    }
+    events[event_count++] = Event{us, buttons};
+}
+
+static bool load_trace(const char *path, uint32_t *seed, uint64_t *end_us)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return false;
+    char line[128];
+    while (fgets(line, sizeof(line), f))
+    {
+        unsigned long long us;
+        unsigned buttons, s;
+        if (sscanf(line, "# seed %u", &s) == 1)
+            *seed = s;
+        else if (sscanf(line, "# end %llu", &us) == 1)
+            *end_us = us;
+        else if (line[0] != '#' && sscanf(line, "%llu %x", &us, &buttons) == 2)
+            add_event(us, buttons);
+    }
+    fclose(f);
+    return true;
+}
+
+static void script_input(uint32_t seed, uint64_t end_us)
+{
+    SimMasher m;
+    sim_masher_init(&m, seed);
+    while (m.next_us < end_us)
+    {
+        uint64_t us;
+        uint32_t buttons;
+        sim_masher_next(&m, &us, &buttons);
+        add_event(us, buttons);
+    }
+}
+
+static int run_bot(uint32_t seed, uint32_t pieces, int beam, int depth, unsigned threads, uint64_t budget_us,
+                   size_t tt_kb, int rollouts, int horizon, uint64_t tick_us)
+{
+    static TetrisGame g;
+    static TetrisBot bot;
+    tetris_game_init(&g, seed, 0);
+    tetris_bot_init(&bot, beam, depth);
+    WorkStealPool pool(threads);
+    if (!bot_use_pool(&bot, &pool))
+    {
+        fprintf(stderr, "at most %d threads\n", TETRIS_BOT_WORKERS_MAX);
+        return 2;
+    }
+    bot.clock_us = bot_clock_us;
+    tetris_bot_set_rollouts(&bot, rollouts, horizon);
+    TetrisTT tt;
+    TetrisTTBucket *buckets = NULL;
+    if (tt_kb)
+    {
+        buckets = (TetrisTTBucket *)aligned_alloc(sizeof(TetrisTTBucket), tt_kb * 1024);
+        if (!buckets)
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        tetris_tt_init(&tt, buckets, tt_kb * 1024);
+        tetris_bot_set_tt(&bot, &tt);
+    }
+
+    uint64_t lines = 0, now = 0, plies = 0;
+    double think = 0, worst = 0;
+    while (g.pieces < pieces)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t lock_us = tetris_bot_deadline_us(&g);
+        uint64_t left = (lock_us > now) ? lock_us - now : 0;
+        if (budget_us && budget_us < left)
+            left = budget_us;
+        bot.deadline_us = bot_clock_us() + left;
+        TetrisPlan plan;
+        bool ok = tetris_bot_plan(&bot, &g, &plan);
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        think += s;
+        worst = (s > worst) ? s : worst;
+        if (!ok)
+        {
+            fprintf(stderr, "no placement for piece %u\n", (unsigned)g.pieces);
+            return 1;
+        }
+        plies += plan.depth;
+        tetris_bot_play(&g, &plan);
+        lines += __builtin_popcount(g.cleared_rows);
+        tetris_game_step(&g, 0, now += tick_us);
+    }
+
+    printf("seed %u, bot with beam %d, depth %d, %d threads\n", (unsigned)seed, bot.beam, bot.depth, bot.workers);
+    printf("pieces %u, lines %llu (%.3f per piece), top-outs %u, score %d\n", (unsigned)g.pieces,
+           (unsigned long long)lines, (double)lines / g.pieces, (unsigned)g.top_outs, g.score);
+    printf("state hash %08x\n", (unsigned)tetris_game_hash(&g));
+    uint64_t nodes = tetris_bot_movegen_nodes(&bot);
+    printf("%llu placements scored, %.2f M/s; %llu movegen nodes, %.2f M/s\n", (unsigned long long)bot.evaluated,
+           bot.evaluated / think / 1e6, (unsigned long long)nodes, nodes / think / 1e6);
+    printf("decision %.1f us average, %.1f us worst; %u cut short by the deadline, %.2f plies average\n",
+           think / bot.plans * 1e6, worst * 1e6, (unsigned)bot.cut, (double)plies / bot.plans);
+    if (buckets)
+    {
+        printf("table %zu KB: %.1f%% of evaluations found, %llu computed; %llu transpositions dropped\n",
+               tetris_tt_bytes(&tt) / 1024, 100.0 * bot.tt_hits / bot.tt_probes,
+               (unsigned long long)(bot.tt_probes - bot.tt_hits), (unsigned long long)bot.dupes);
+        free(buckets);
+    }
+    if (bot.rollouts)
+        printf("rollouts %d of %d pieces: %llu played, %.0f per second; %u plans exact, %u overruled the beam\n",
+               bot.rollouts, bot.horizon, (unsigned long long)bot.rolled, bot.rolled / think, (unsigned)bot.exact,
+               (unsigned)bot.overruled);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seed = 1;
+    uint64_t end_us = 0;
+    uint64_t tick_us = 1000;
+    const char *trace = NULL, *record = NULL;
+    bool bot = false;
+    uint32_t pieces = 10000;
+    int beam = 8, depth = 3;
+    unsigned threads = 1;
+    uint64_t budget_us = 0;
+    size_t tt_kb = 4096;
+    int rollouts = 0, horizon = 7;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-bot"))
+            bot = true;
+        else if (!strcmp(argv[i], "-pieces") && i + 1 < argc)
+            pieces = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-beam") && i + 1 < argc)
+            beam = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-depth") && i + 1 < argc)
+            depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-threads") && i + 1 < argc)
+            threads = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-budget-us") && i + 1 < argc)
+            budget_us = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-tt-kb") && i + 1 < argc)
+            tt_kb = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-rollouts") && i + 1 < argc)
+            rollouts = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-horizon") && i + 1 < argc)
+            horizon = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-seed") && i + 1 < argc)
+            seed = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-ms") && i + 1 < argc)
+            end_us = strtoull(argv[++i], NULL, 0) * 1000;
+        else if (!strcmp(argv[i], "-tick-us") && i + 1 < argc)
+            tick_us = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-record") && i + 1 < argc)
+            record = argv[++i];
+        else if (argv[i][0] != '-')
+            trace = argv[i];
+        else
+        {
+            fprintf(stderr, "usage: %s [-seed N] [-ms N] [-tick-us N] [-record FILE] [TRACE]\n", argv[0]);
+            fprintf(stderr,
+                    "       %s -bot [-seed N] [-pieces N] [-beam N] [-depth N] [-threads N] [-budget-us N] [-tt-kb N]\n"
+                    "               [-rollouts N] [-horizon N]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (bot)
+        return run_bot(seed, pieces, beam, depth, threads ? threads : 1, budget_us, tt_kb, rollouts, horizon, tick_us);
+
+    if (trace)
+    {
+        uint64_t trace_end = 0;
+        if (!load_trace(trace, &seed, &trace_end))
+        {
+            fprintf(stderr, "cannot read %s\n", trace);
+            return 2;
+        }
+        if (!end_us)
+            end_us = trace_end ? trace_end : event_count ? events[event_count - 1].us : 0;
+    }
+    else
+    {
+        if (!end_us)
+            end_us = 600 * 1000000ull; // ten minutes of play
+        script_input(seed, end_us);
+    }
+
+    if (record)
+    {
+        FILE *f = fopen(record, "w");
+        if (!f)
+        {
+            fprintf(stderr, "cannot write %s\n", record);
+            return 2;
+        }
+        fprintf(f, "# seed %u\n", (unsigned)seed);
+        for (size_t i = 0; i < event_count; i++)
+            fprintf(f, "%llu %x\n", (unsigned long long)events[i].us, (unsigned)events[i].buttons);
+        fprintf(f, "# end %llu\n", (unsigned long long)end_us);
+        fclose(f);
+    }
+
+    static TetrisGame g;
+    tetris_game_init(&g, seed, 0);
+
+    auto t0 = std::chrono::steady_clock::now();
+    uint32_t buttons = 0;
+    uint64_t steps = 0;
+    size_t next = 0;
+    for (uint64_t now = 0; now <= end_us; now += tick_us)
+    {
+        while (next < event_count && events[next].us <= now)
+            buttons = events[next++].buttons;
+        tetris_game_step(&g, buttons, now);
+        steps++;
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    printf("seed %u, %.1f s of play in %llu steps of %llu us\n", (unsigned)seed, end_us / 1e6,
+           (unsigned long long)steps, (unsigned long long)tick_us);
+    printf("pieces %u, lines %d, level %d, score %d\n", (unsigned)g.pieces, g.lines, g.level, g.score);
+    printf("state hash %08x\n", (unsigned)tetris_game_hash(&g));
+    printf("%.1f M steps/s, x%.0f real time\n", steps / wall / 1e6, end_us / 1e6 / wall);
+    free(events);
+    return 0;
+}
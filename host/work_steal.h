@@ -0,0 +1,161 @@
+#ifndef WORK_STEAL_H_
+#define WORK_STEAL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool for the host tools. run() hands out task indices
+// 0..count-1 as one contiguous range per worker; a worker takes tasks from
+// the front of its own range and, once it runs dry, steals the back half of
+// another worker's range. Tasks of very different cost (games that top out
+// early, search subtrees) so even out without a shared queue to fight over.
+//
+// The calling thread works as worker 0; the other workers sleep between runs.
+
+class WorkStealPool
+{
+public:
+    typedef std::function<void(size_t task, unsigned worker)> Task;
+
+    // threads = 0: one worker per hardware thread
+    explicit WorkStealPool(unsigned threads = 0)
+    {
+        if (!threads)
+            threads = std::thread::hardware_concurrency();
+        if (!threads)
+            threads = 1;
+        count = threads;
+        queues.reset(new Queue[threads]);
+        for (unsigned i = 1; i < threads; i++)
+            workers.emplace_back(&WorkStealPool::worker_main, this, i);
+    }
+
+    ~WorkStealPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(run_mutex);
+            quit = true;
+        }
+        start.notify_all();
+        for (auto &t : workers)
+            t.join();
+    }
+
+    unsigned size() const { return count; }
+    // ranges taken from another worker since construction
+    uint64_t steals() const { return steal_count.load(); }
+
+    // Runs fn for every task in [0, tasks) and returns when all are done
+    void run(size_t tasks, const Task &fn)
+    {
+        for (unsigned i = 0; i < count; i++)
+        {
+            queues[i].begin = tasks * i / count;
+            queues[i].end = tasks * (i + 1) / count;
+        }
+        {
+            std::lock_guard<std::mutex> lock(run_mutex);
+            job = &fn;
+            busy = count;
+            generation++;
+        }
+        start.notify_all();
+        drain(0);
+        std::unique_lock<std::mutex> lock(run_mutex);
+        done.wait(lock, [this] { return busy == 0; });
+        job = nullptr;
+    }
+
+private:
+    struct alignas(64) Queue
+    {
+        std::mutex mutex;
+        size_t begin = 0, end = 0;
+    };
+
+    unsigned count;
+    std::unique_ptr<Queue[]> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex run_mutex;
+    std::condition_variable start, done;
+    const Task *job = nullptr;
+    uint64_t generation = 0;
+    unsigned busy = 0;
+    bool quit = false;
+    std::atomic<uint64_t> steal_count{0};
+
+    bool pop(unsigned id, size_t *task)
+    {
+        Queue &q = queues[id];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.begin == q.end)
+            return false;
+        *task = q.begin++;
+        return true;
+    }
+
+    // Moves the back half of the first non-empty range found into ours;
+    // false when every range is empty, which ends the run for this worker
+    bool steal(unsigned id)
+    {
+        for (unsigned k = 1; k < count; k++)
+        {
+            Queue &victim = queues[(id + k) % count];
+            size_t begin, end;
+            {
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (victim.begin == victim.end)
+                    continue;
+                end = victim.end;
+                begin = victim.begin + (victim.end - victim.begin) / 2;
+                victim.end = begin;
+            }
+            Queue &own = queues[id];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            own.begin = begin;
+            own.end = end;
+            steal_count++;
+            return true;
+        }
+        return false;
+    }
+
+    void drain(unsigned id)
+    {
+        const Task &fn = *job;
+        size_t task;
+        do
+        {
+            while (pop(id, &task))
+                fn(task, id);
+        } while (steal(id));
+
+        std::lock_guard<std::mutex> lock(run_mutex);
+        if (--busy == 0)
+            done.notify_all();
+    }
+
+    void worker_main(unsigned id)
+    {
+        uint64_t seen = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(run_mutex);
+                start.wait(lock, [&] { return quit || generation != seen; });
+                if (quit)
+                    return;
+                seen = generation;
+            }
+            drain(id);
+        }
+    }
+};
+
+#endif
@@ -2,15 +2,25 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
-#include <vector>
-#include <map>
 #include "pico/time.h"
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
 #include "hardware/timer.h"
 #include "drivers/st7735.h"
+#include "drivers/st7735_dl.h"
+#include "game/tetris_game.h"
+#if TETRIS_AUTOPLAY
+#include "game/tetris_bot.h"
+#endif
+#if TETRIS_PC_HINT
+#include "game/tetris_pc.h"
+#endif
 #include <hardware/clocks.h>
 #include "images.h"
+#if TETRIS_DUAL_CORE || TETRIS_AUTOPLAY
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+#endif
 
 #define PIN_LEFT   10
 #define PIN_RIGHT  8
@@ -21,8 +31,40 @@
 #define PIN_ROT_CCW  11
 #define PIN_HOLD 15
 
-#define DAS_MS 142
-#define ARR_MS 1
+// core0 runs the game at a fixed tick and hands snapshots to core1, which
+// renders and presents them; 0 keeps everything in one loop on core0
+#ifndef TETRIS_DUAL_CORE
+#define TETRIS_DUAL_CORE 0
+#endif
+
+// frame and display stats on stdio once a second
+#ifndef TETRIS_STATS
+#define TETRIS_STATS 0
+#endif
+
+// the bot (game/tetris_bot.h) plays instead of the buttons; pause still works
+#ifndef TETRIS_AUTOPLAY
+#define TETRIS_AUTOPLAY 0
+#endif
+#ifndef TETRIS_AUTOPLAY_BEAM
+#define TETRIS_AUTOPLAY_BEAM 4
+#endif
+#ifndef TETRIS_AUTOPLAY_DEPTH
+#define TETRIS_AUTOPLAY_DEPTH 2
+#endif
+// transposition table in spare SRAM; 0 = none
+#ifndef TETRIS_AUTOPLAY_TT_KB
+#define TETRIS_AUTOPLAY_TT_KB 32
+#endif
+
+// "PC" on screen while the visible pieces can clear the field (game/tetris_pc.h)
+#ifndef TETRIS_PC_HINT
+#define TETRIS_PC_HINT 0
+#endif
+// search time per piece, us
+#ifndef TETRIS_PC_HINT_US
+#define TETRIS_PC_HINT_US 2000
+#endif
 
 #define PIECE_COLOR ST7735_WHITE
 #define FIELD_COLOR ST7735_WHITE
@@ -34,83 +76,47 @@ static void btn_init(int pin){
     gpio_pull_up(pin);
 }
 
-std::map<int, uint16_t> number_to_color = {
-    {0, 0x5ffe},
-    {1, 0xD5a9},
-    {2, 0xaa54},
-    {3, 0x85a6},
-    {4, 0xfa08},
-    {5, 0x4a7f},
-    {6, 0xfe67},
+// by piece type (game/tetris_pieces.h order)
+static constexpr uint16_t number_to_color[7] = {
+    0x5ffe, // I
+    0xD5a9, // O
+    0xaa54, // T
+    0x85a6, // S
+    0xfa08, // Z
+    0x4a7f, // J
+    0xfe67, // L
 };
 
-class ButtonHandler {
-public:
-    ButtonHandler(uint pin, void (*callback)())
-        : pin(pin), callback(callback), state(false),
-          pressedTime(0), lastRepeatTime(0), repeating(false) 
-    {
-        gpio_init(pin);
-        gpio_set_dir(pin, GPIO_IN);
-        gpio_pull_up(pin);
-    }
-
-    void update() {
-        bool isPressed = readButton();
-        uint64_t now = millis();
-
-        if (isPressed && !state) {
-            // Button just pressed
-            state = true;
-            pressedTime = now;
-            lastRepeatTime = now;
-            repeating = false;
-            callback();
-        }
-        else if (isPressed && state) {
-            // Button is being held
-            if (!repeating && (now - pressedTime >= DAS_MS)) {
-                repeating = true;
-                lastRepeatTime = now;
-                callback();
-            }
-            else if (repeating && (now - lastRepeatTime >= ARR_MS)) {
-                lastRepeatTime = now;
-                callback(); // Subsequent repeats
-            }
-        }
-        else if (!isPressed && state) {
-            // Button released
-            state = false;
-            repeating = false;
-        }
-    }
-
-private:
-    uint pin;
-    bool state;
-    bool repeating;
-    uint64_t pressedTime;
-    uint64_t lastRepeatTime;
-    void (*callback)();
-
-    uint64_t millis() {
-        return time_us_64() / 1000;
-    }
-
-    bool readButton() {
-        return gpio_get(pin) == 0;
-    }
-};
+// the buttons as the game core sees them, sampled once per step
+static uint32_t read_buttons() {
+    static const struct { uint8_t pin; uint32_t bit; } map[] = {
+        {PIN_LEFT, TETRIS_BTN_LEFT}, {PIN_RIGHT, TETRIS_BTN_RIGHT},
+        {PIN_ROT, TETRIS_BTN_ROT_CW}, {PIN_ROT_CCW, TETRIS_BTN_ROT_CCW},
+        {PIN_SDROP, TETRIS_BTN_SOFT_DROP}, {PIN_HDROP, TETRIS_BTN_HARD_DROP},
+        {PIN_HOLD, TETRIS_BTN_HOLD}, {PIN_PAUSE, TETRIS_BTN_PAUSE},
+    };
+    uint32_t buttons = 0;
+    for (const auto &m : map)
+        if (gpio_get(m.pin) == 0) buttons |= m.bit;
+    return buttons;
+}
 
 uint32_t fps_counter = 0;
 uint32_t fps_value = 0;
 absolute_time_t fps_timer;
 
+// the scene of the frame being presented, recorded by render_frame()
+static ST7735_DisplayList frame_dl;
+
 void update_fps() {
     fps_counter++;
     if (absolute_time_diff_us(fps_timer, get_absolute_time()) / 1000000 >= 1) {
         fps_value = fps_counter;
+#if TETRIS_STATS
+        ST7735_DLStats dl = ST7735_DL_GetStats(&frame_dl);
+        printf("fps %u, %u B/frame, %u cmds, raster %u us\n", (unsigned)fps_value,
+               (unsigned)ST7735_GetFrameStats().bytes, (unsigned)dl.commands, (unsigned)dl.raster_us);
+#endif
         fps_counter = 0;
         fps_timer = get_absolute_time();
     }
@@ -119,8 +125,9 @@ void update_fps() {
 #define ghost_lines 1
 static const int CELL_W = 6;   // px
 static const int CELL_H = 6;   // px
-static const int COLS   = 10;
-static const int ROWS   = 20 + ghost_lines;
+static const int COLS   = TETRIS_COLS;
+static const int ROWS   = TETRIS_ROWS;
+static_assert(ROWS == 20 + ghost_lines, "field rows");
 
 static const int FIELD_W = COLS * CELL_W;
 static const int FIELD_H = (ROWS - ghost_lines) * CELL_H;
@@ -138,284 +145,22 @@ static const int PREV_BOX_H = 4*MINI + 2;
 static const int PREV_SPACING = 4;         // vertical spacing between previews
 static const int NEXT_SHOW = 4;            // show 4 next pieces
 
-static const int SOFT_DROP_MS  = 1;   // soft drop tick
-static const int LOCK_DELAY_MS = 500;  // lock delay when grounded
-
-static uint8_t board[ROWS][COLS];
-
-static const uint8_t TETROMINOES[7][4][16] = {
-    // I
-    {
-        {0,0,0,0, 1,1,1,1, 0,0,0,0, 0,0,0,0},
-        {0,0,1,0, 0,0,1,0, 0,0,1,0, 0,0,1,0},
-        {0,0,0,0, 1,1,1,1, 0,0,0,0, 0,0,0,0},
-        {0,0,1,0, 0,0,1,0, 0,0,1,0, 0,0,1,0}
-    },
-    // O
-    {
-        {0,1,1,0, 0,1,1,0, 0,0,0,0, 0,0,0,0},
-        {0,1,1,0, 0,1,1,0, 0,0,0,0, 0,0,0,0},
-        {0,1,1,0, 0,1,1,0, 0,0,0,0, 0,0,0,0},
-        {0,1,1,0, 0,1,1,0, 0,0,0,0, 0,0,0,0}
-    },
-    // T
-    {
-        {0,1,0,0, 1,1,1,0, 0,0,0,0, 0,0,0,0},
-        {0,1,0,0, 0,1,1,0, 0,1,0,0, 0,0,0,0},
-        {0,0,0,0, 1,1,1,0, 0,1,0,0, 0,0,0,0},
-        {0,1,0,0, 1,1,0,0, 0,1,0,0, 0,0,0,0}
-    },
-    // S
-    {
-        {0,1,1,0, 1,1,0,0, 0,0,0,0, 0,0,0,0},
-        {0,1,0,0, 0,1,1,0, 0,0,1,0, 0,0,0,0},
-        {0,0,0,0, 0,1,1,0, 1,1,0,0, 0,0,0,0},
-        {1,0,0,0, 1,1,0,0, 0,1,0,0, 0,0,0,0}
-    },
-    // Z
-    {
-        {1,1,0,0, 0,1,1,0, 0,0,0,0, 0,0,0,0},
-        {0,0,1,0, 0,1,1,0, 0,1,0,0, 0,0,0,0},
-        {0,0,0,0, 1,1,0,0, 0,1,1,0, 0,0,0,0},
-        {0,1,0,0, 1,1,0,0, 1,0,0,0, 0,0,0,0}
-    },
-    // J
-    {
-        {1,0,0,0, 1,1,1,0, 0,0,0,0, 0,0,0,0},
-        {0,1,1,0, 0,1,0,0, 0,1,0,0, 0,0,0,0},
-        {0,0,0,0, 1,1,1,0, 0,0,1,0, 0,0,0,0},
-        {0,1,0,0, 0,1,0,0, 1,1,0,0, 0,0,0,0}
-    },
-    // L
-    {
-        {0,0,1,0, 1,1,1,0, 0,0,0,0, 0,0,0,0},
-        {0,1,0,0, 0,1,0,0, 0,1,1,0, 0,0,0,0},
-        {0,0,0,0, 1,1,1,0, 1,0,0,0, 0,0,0,0},
-        {1,1,0,0, 0,1,0,0, 0,1,0,0, 0,0,0,0}
-    }
-};
-
-enum PieceType {O=1,T=2,S=3,Z=4,J=5,L=6,I=7};
-
-struct Piece {
-    int t; // 1..7
-    int r; // 0..3
-    int x; // col
-    int y; // row
-};
-
-static Piece cur;
-static Piece holded;
-static std::vector<int> bag;
-static std::vector<int> next_queue;
-static bool paused = false;
-static int score = 0;
-static int lines_cleared = 0;
-static int level = 1;
-
-// RNG & 7-bag 
-static uint32_t rng_state = 0x12345678;
-static inline uint32_t xorshift32() {
-    uint32_t x = rng_state;
-    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
-    rng_state = x; return x;
-}
-static void shuffle7(int a[7]) {
-    for (int i=6;i>0;i--) {
-        int j = xorshift32() % (i+1);
-        int tmp=a[i]; a[i]=a[j]; a[j]=tmp;
-    }
-}
-static void refill_bag() {
-    int a[7] = {0,1,2,3,4,5,6};
-    shuffle7(a);
-    for (int i=0;i<7;i++) bag.push_back(a[i]);
-}
-static int get_next_piece() {
-    if (bag.empty()) refill_bag();
-    int t = bag.front(); bag.erase(bag.begin());
-    return t;
-}
-static void ensure_next_queue(int n) {
-    while ((int)next_queue.size() < n) {
-        next_queue.push_back(get_next_piece());
-    }
-}
-
-// wall kicks
-static const int8_t SRS_JLSTZ[4][5][2] = {
-    // 0->1
-    { { 0, 0}, {-1, 0}, {-1, -1}, { 0, 2}, {-1, 2} },
-    // 1->2
-    { { 0, 0}, {+1, 0}, {+1,+1}, { 0,-2}, {+1,-2} },
-    // 2->3
-    { { 0, 0}, {+1, 0}, {+1,-1}, { 0,+2}, {+1,+2} },
-    // 3->0
-    { { 0, 0}, {-1, 0}, {-1,+1}, { 0,-2}, {-1,-2} }
-};
-
-// static const int8_t SRS_JLSTZ[4][5][2] = {
-//     // 0->1
-//     { { 0, -5}, { 0, -5}, { 0, -5}, { 0, -5}, { 0, -5} },
-//     // 1->2
-//     { { 0, -5}, { 0, -5}, { 0, -5}, { 0, -5}, { 0, -5} },
-//     // 2->3
-//     { { 0, -5}, { 0, -5}, { 0, -5}, { 0, -5}, { 0, -5} },
-//     // 3->0
-//     { { 0, -5}, { 0, -5}, { 0, -5}, { 0, -5}, { 0, -5} },
-// };
-
-static const int8_t SRS_I[4][5][2] = {
-    // 0->1
-    { { 0, 0}, {-2, 0}, {+1, 0}, {-2,+1}, {+1,-2} },
-    // 1->2
-    { { 0, 0}, {-1, 0}, {+2, 0}, {-1,-2}, {+2,+1} },
-    // 2->3
-    { { 0, 0}, {-2, 0}, {-1, 0}, {+2,-1}, {-1,+2} },
-    // 3->0
-    { { 0, 0}, {+1, 0}, {-2, 0}, {+1,+2}, {-2,-1} }
-};
-
-static const int8_t SRS_O[4][1][2] = {
-    { {0,0} }, { {0,0} }, { {0,0} }, { {0,0} }
-};
-
-static inline bool in_bounds(int r, int c) {
-    return (r>=0 && r<ROWS && c>=0 && c<COLS);
-}
-static inline bool cell_blocked(int r, int c) {
-    if (!in_bounds(r,c)) return true;
-    return board[r][c] != 0;
-}
-static bool can_place(const Piece& p) {
-    const uint8_t* sh = TETROMINOES[p.t][p.r];
-    for (int yy = 0; yy < 4; ++yy) {
-        for (int xx = 0; xx < 4; ++xx) {
-            if (!sh[yy*4 + xx]) continue;
-
-            int r = p.y + yy;
-            int c = p.x + xx;
-
-            if (r < 0) {
-                if (c < 0 || c >= COLS) return false;
-                continue;
-            }
-
-            if (c < 0 || c >= COLS || r >= ROWS) return false;
-            if (board[r][c]) return false;
-        }
-    }
-    return true;
-}
-
-static inline bool btn_down(int pin) {
-    return gpio_get(pin) == 0;
-}
+static TetrisGame game;
 
-static bool try_rotate_srs(Piece &pc, int dir) {
-    int from = pc.r;
-    int to   = (pc.r + (dir>0?1:3)) & 3;
-    Piece test = pc; test.r = to;
+// table order of game/tetris_pieces.h
+enum PieceType {I=TETRIS_I,O=TETRIS_O,T=TETRIS_T,S=TETRIS_S,Z=TETRIS_Z,J=TETRIS_J,L=TETRIS_L};
 
-    if (pc.t == O) {
-        return true;
-    }
-    const int8_t (*tab)[5][2] = (pc.t == I) ? SRS_I : SRS_JLSTZ;
-    int idx = from;
-    for (int i=0;i<5;i++) {
-        int dx = tab[idx][i][0], dy = tab[idx][i][1];
-        test.x = pc.x + dx; test.y = pc.y + dy;
-        if (can_place(test)) { pc = test; return true; }
-    }
-    return false;
-}
-
-static bool grounded(const Piece& p) {
-    Piece t = p; t.y++;
-    return !can_place(t);
-}
+typedef TetrisPiece Piece;
 
-static void lock_piece(const Piece& p) {
-    const uint8_t* sh = TETROMINOES[p.t][p.r];
-    for (int yy=0; yy<4; yy++)
-        for (int xx=0; xx<4; xx++)
-            if (sh[yy*4 + xx]) {
-                int r = p.y + yy;
-                int c = p.x + xx;
-                if (in_bounds(r,c)) board[r][c] = p.t + 1;
-            }
-}
-
-static int clear_lines() {
-    int cleared = 0;
-    for (int r = ROWS-1; r >= 0; r--) {
-        bool full = true;
-        for (int c=0;c<COLS;c++) if (!board[r][c]) { full=false; break; }
-        if (full) {
-            cleared++;
-            for (int rr=r; rr>0; rr--)
-                for (int c=0;c<COLS;c++)
-                    board[rr][c] = board[rr-1][c];
-            for (int c=0;c<COLS;c++) board[0][c] = 0;
-            r++;
-        }
-    }
-    return cleared;
-}
-bool was_holded_this_turn = false;
-
-static void new_piece_from_queue() {
-    ensure_next_queue(7);
-    cur.t = next_queue.front();
-    next_queue.erase(next_queue.begin());
-    cur.r = 0;
-    cur.x = (COLS/2) - 2;
-    cur.y = 0;
-    ensure_next_queue(7);
-    // game over check
-    for (uint8_t i = 0; i < COLS; i++){
-        if (board[0][i]) {
-            memset(board, 0, sizeof(board));
-            score = 0; lines_cleared = 0; level = 1;
-            next_queue.clear(); ensure_next_queue(7);
-            ST7735_FillScreen(ST7735_BLACK);
-            break;
-        }
-    }
-}
-
-void move_left() {
-    Piece t = cur; t.x--;
-    if (can_place(t)) {
-        cur = t;
-    }
-}
-
-void move_right() {
-    Piece t = cur; t.x++;
-    if (can_place(t)) {
-        cur = t;
-    }
-}
-
-static Piece ghost_of(const Piece& p) {
-    Piece g = p;
-    while (true) {
-        Piece n = g; n.y++;
-        if (can_place(n)) g = n; else break;
-    }
-    return g;
-}
-
-static void draw_holded_cell(int c, int r, int piece_type) {
+static void draw_holded_cell(int c, int r, int piece_type, bool used) {
     int x = FIELD_X + c * CELL_W;
     int y = FIELD_Y + r * CELL_H;
     int w = CELL_W - 1;
     int h = CELL_H - 1;
     if (w < 1) w = 1;
     if (h < 1) h = 1;
-    if (was_holded_this_turn)ST7735_DrawRectFill(x, y, w + 1, h + 1, 0x73ae);
-    else ST7735_DrawRectFill(x, y, w + 1, h + 1, number_to_color[piece_type]);
+    if (used)ST7735_DL_RectFill(&frame_dl, x, y, w + 1, h + 1, 0x73ae);
+    else ST7735_DL_RectFill(&frame_dl, x, y, w + 1, h + 1, number_to_color[piece_type]);
 }
 
 static void draw_cell(int c, int r, int piece_type) {
@@ -425,7 +170,7 @@ static void draw_cell(int c, int r, int piece_type) {
     int h = CELL_H - 1;
     if (w < 1) w = 1;
     if (h < 1) h = 1;
-    ST7735_DrawRectFill(x, y, w + 1, h + 1, number_to_color[piece_type]);
+    ST7735_DL_RectFill(&frame_dl, x, y, w + 1, h + 1, number_to_color[piece_type]);
 }
 
 static void draw_cell_ghost(int c, int r) {
@@ -434,296 +179,386 @@ static void draw_cell_ghost(int c, int r) {
     int w = CELL_W - 1; if (w < 1) w = 1;
     int h = CELL_H - 1; if (h < 1) h = 1;
 
-    for (int xx=0; xx<w; xx++) {
-        ST7735_DrawPixel(x + xx, y, PIECE_COLOR);
-        ST7735_DrawPixel(x + xx, y+h-1, PIECE_COLOR);
-    }
-    for (int yy=0; yy<h; yy++) {
-        ST7735_DrawPixel(x, y + yy, PIECE_COLOR);
-        ST7735_DrawPixel(x + w - 1, y+yy, PIECE_COLOR);
-    }
-
+    ST7735_DL_Rect(&frame_dl, x, y, w, h, PIECE_COLOR);
 }
 
 static void draw_field_outline() {
-    ST7735_DrawRectFill(FIELD_X-1, FIELD_Y-1 + ghost_lines * CELL_W, FIELD_W+2, 1, FIELD_COLOR);
-    ST7735_DrawRectFill(FIELD_X-1, FIELD_Y+FIELD_H + ghost_lines * CELL_W, FIELD_W+2, 1, FIELD_COLOR);
-    ST7735_DrawRectFill(FIELD_X-1, FIELD_Y+ ghost_lines * CELL_W, 1, FIELD_H, FIELD_COLOR);
-    ST7735_DrawRectFill(FIELD_X+FIELD_W, FIELD_Y+ ghost_lines * CELL_W, 1, FIELD_H, FIELD_COLOR);
+    ST7735_DL_RectFill(&frame_dl, FIELD_X-1, FIELD_Y-1 + ghost_lines * CELL_W, FIELD_W+2, 1, FIELD_COLOR);
+    ST7735_DL_RectFill(&frame_dl, FIELD_X-1, FIELD_Y+FIELD_H + ghost_lines * CELL_W, FIELD_W+2, 1, FIELD_COLOR);
+    ST7735_DL_RectFill(&frame_dl, FIELD_X-1, FIELD_Y+ ghost_lines * CELL_W, 1, FIELD_H, FIELD_COLOR);
+    ST7735_DL_RectFill(&frame_dl, FIELD_X+FIELD_W, FIELD_Y+ ghost_lines * CELL_W, 1, FIELD_H, FIELD_COLOR);
 }
 
-static void draw_board() {
+static void draw_board(const uint8_t (&cells)[ROWS][COLS]) {
     for (int r=0;r<ROWS;r++)
         for (int c=0;c<COLS;c++)
-            if (board[r][c]) draw_cell(c, r, board[r][c]-1);
+            if (cells[r][c]) draw_cell(c, r, cells[r][c]-1);
     }
 
 static void draw_piece(const Piece& p) {
-    const uint8_t* sh = TETROMINOES[p.t][p.r];
-    for (int yy=0; yy<4; yy++)
-        for (int xx=0; xx<4; xx++)
-            if (sh[yy*4 + xx]) {
-                int r = p.y + yy;
-                int c = p.x + xx;
-                if (r>=0) draw_cell(c, r, p.t); 
-            }
+    const uint8_t* cells = TETRIS_TABLES.cells[p.t][p.r];
+    for (int i=0; i<4; i++) {
+        int r = p.y + (cells[i] >> 2);
+        int c = p.x + (cells[i] & 3);
+        if (r>=0) draw_cell(c, r, p.t); 
+    }
 }
 
-static void draw_holded(const Piece& p) {
+static void draw_holded(const Piece& p, bool used) {
     if (p.t == -1) {return;}
-    const uint8_t* sh = TETROMINOES[p.t][0]; // 0 rotation
-    for (int yy=0; yy<4; yy++)
-        for (int xx=0; xx<4; xx++)
-            if (sh[yy*4 + xx]) {
-                int r = 3 + yy; // out of board coordinates
-                int c = 16 + xx; // out of board coordinates
-                if (r>=0) draw_holded_cell(c, r, p.t); 
-            }
+    const uint8_t* cells = TETRIS_TABLES.cells[p.t][0]; // 0 rotation
+    for (int i=0; i<4; i++) {
+        int r = 3 + (cells[i] >> 2); // out of board coordinates
+        int c = 16 + (cells[i] & 3); // out of board coordinates
+        draw_holded_cell(c, r, p.t, used); 
+    }
 }
 
 
-static void draw_ghost(const Piece& p) {
-    Piece g = ghost_of(p);
-    const uint8_t* sh = TETROMINOES[g.t][g.r];
-    for (int yy=0; yy<4; yy++)
-        for (int xx=0; xx<4; xx++)
-            if (sh[yy*4 + xx]) {
-                int r = g.y + yy;
-                int c = g.x + xx;
-                if (r>=0) draw_cell_ghost(c,r);
-            }
+static void draw_ghost(const Piece& g) {
+    const uint8_t* cells = TETRIS_TABLES.cells[g.t][g.r];
+    for (int i=0; i<4; i++) {
+        int r = g.y + (cells[i] >> 2);
+        int c = g.x + (cells[i] & 3);
+        if (r>=0) draw_cell_ghost(c,r);
+    }
 }
 
 static void draw_mini_piece(int t, int x, int y) {
-    const uint8_t* sh = TETROMINOES[t][0];
-    for (int yy=0; yy<4; yy++)
-        for (int xx=0; xx<4; xx++)
-            if (sh[yy*4 + xx]) {
-                int px = x + 1 + xx*MINI;
-                int py = y + 1 + yy*MINI;
-                ST7735_DrawRectFill(px, py, MINI, MINI, number_to_color[t]);
-            }
+    const uint8_t* cells = TETRIS_TABLES.cells[t][0];
+    for (int i=0; i<4; i++) {
+        int px = x + 1 + (cells[i] & 3)*MINI;
+        int py = y + 1 + (cells[i] >> 2)*MINI;
+        ST7735_DL_RectFill(&frame_dl, px, py, MINI, MINI, number_to_color[t]);
+    }
 }
 
-static void draw_queue() {
+static void draw_queue(const int *next, int count) {
     int y = PANEL_Y + 2 + ghost_lines * CELL_W;
-    for (int i=0; i<NEXT_SHOW && i<(int)next_queue.size(); i++) {
-        draw_mini_piece(next_queue[i], PANEL_X, y);
+    for (int i=0; i<count; i++) {
+        draw_mini_piece(next[i], PANEL_X, y);
         y += PREV_BOX_H + PREV_SPACING;
         if (y > PANEL_Y + PANEL_H - PREV_BOX_H) break;
     }
 }
 
-static absolute_time_t last_fall;
-static absolute_time_t last_softdrop;
-static bool was_grounded = false;
-static absolute_time_t grounded_time;
-
-static int gravity_interval_ms() {
-    if (level < 2)  return 700;
-    if (level < 4)  return 500;
-    if (level < 6)  return 380;
-    if (level < 8)  return 300;
-    if (level < 10) return 220;
-    if (level < 12) return 160;
-    if (level < 15) return 120;
-    if (level < 18) return 90;
-    return 70;
+static bool pc_available;
+
+#if TETRIS_PC_HINT
+static TetrisPCSolver pc;
+static TetrisTTBucket pc_memo_buckets[8 * 1024 / sizeof(TetrisTTBucket)];
+static TetrisTT pc_memo;
+
+// Searches again whenever a piece locks or goes into hold, for at most
+// TETRIS_PC_HINT_US; a search that runs out of time shows nothing
+static void pc_hint(uint64_t now) {
+    static uint32_t seen = UINT32_MAX;
+    uint32_t state = game.pieces << 1 | game.hold_used;
+    if (state == seen)
+        return;
+    seen = state;
+    pc.deadline_us = now + TETRIS_PC_HINT_US;
+    TetrisPCSolution sol;
+    pc_available = tetris_pc_solve_game(&pc, &game, 4, &sol) == TETRIS_PC_FOUND;
+}
+#endif
+
+// Everything the renderer reads, copied out of the game state once per tick
+struct GameSnapshot {
+    uint8_t board[ROWS][COLS];
+    Piece cur, ghost, holded;
+    bool holded_this_turn;
+    int next[NEXT_SHOW];
+    int next_count;
+    int level;
+    bool paused;
+    bool pc;
+};
+
+static void take_snapshot(GameSnapshot &s) {
+    memcpy(s.board, game.board.color, sizeof(game.board.color));
+    s.cur = game.cur;
+    s.ghost = *tetris_game_ghost(&game);
+    s.holded = game.held;
+    s.holded_this_turn = game.hold_used;
+    s.next_count = 0;
+    for (int i=0; i<NEXT_SHOW && i<game.queue.count; i++)
+        s.next[s.next_count++] = tetris_queue_peek(&game.queue, i);
+    s.level = game.level;
+    s.paused = game.paused;
+    s.pc = pc_available;
+}
+
+// Records the whole scene from a snapshot into frame_dl; rasterized once,
+// or once per band (ST7735_BAND_ROWS)
+static void render_frame(const GameSnapshot &s) {
+    ST7735_DL_Begin(&frame_dl);
+    ST7735_DL_FillScreen(&frame_dl, ST7735_BLACK);
+
+    char level_string[20];
+    snprintf(level_string, sizeof(level_string), "%d", s.level);
+    
+    char fps_string[20];
+    snprintf(fps_string, sizeof(fps_string), "%d", fps_value);
+
+    ST7735_DL_String(&frame_dl, 100, 45, level_string, &Font_11x18, ST7735_WHITE);
+    ST7735_DL_String(&frame_dl, 93, 68, fps_string, &Font_11x18, ST7735_GREEN);
+    if (s.pc)
+        ST7735_DL_String(&frame_dl, 100, 91, "PC", &Font_11x18, ST7735_YELLOW);
+
+    // ST7735_DL_Image(&frame_dl, 0, 0, 160, 128, cat_farmer);
+    draw_field_outline();
+    draw_board(s.board);
+    draw_ghost(s.ghost);
+    draw_piece(s.cur);
+    draw_holded(s.holded, s.holded_this_turn);
+    draw_queue(s.next, s.next_count);
+
+    if (s.paused) { //pause case
+        ST7735_DL_RectFill(&frame_dl, 80-10, 64-16, 5, 20, ST7735_BLACK);
+        ST7735_DL_RectFill(&frame_dl, 80, 64-16, 5, 20, ST7735_BLACK);
+
+        ST7735_DL_Rect(&frame_dl, 79-10, 63-16, 7, 22, ST7735_WHITE);
+        ST7735_DL_Rect(&frame_dl, 79, 63-16, 7, 22, ST7735_WHITE);
+    }
 }
 
-static void move_lr(int dir){
-    Piece t = cur; t.x+=dir;
-    if(can_place(t)) cur = t;
+static void present_frame(const GameSnapshot &s) {
+    render_frame(s);
+#if ST7735_BAND_ROWS
+    ST7735_FirstBand();
+    do {
+        ST7735_DL_Render(&frame_dl);
+    } while (ST7735_NextBand());
+#else
+    ST7735_DL_Render(&frame_dl);
+    ST7735_UpdateAsync();
+#endif
+}
+
+#if TETRIS_AUTOPLAY
+// each new piece stays in view this long before the bot moves it
+static const uint32_t AUTOPLAY_PIECE_MS = 150;
+// search stats on stdio every this many pieces
+static const uint32_t AUTOPLAY_REPORT = 50;
+
+static TetrisBot bot;
+#if TETRIS_AUTOPLAY_TT_KB
+static TetrisTTBucket bot_tt_buckets[TETRIS_AUTOPLAY_TT_KB * 1024 / sizeof(TetrisTTBucket)];
+static TetrisTT bot_tt;
+#endif
+
+#if !TETRIS_DUAL_CORE
+// core1 is free: it helps with the search. Each core takes the tasks of a
+// ply from the front of its own half of the range and, once that runs dry,
+// steals the back half of what the other has left.
+static struct { uint32_t begin, end; } bot_range[2];
+static spin_lock_t *bot_lock;
+static TetrisBotTask bot_fn;
+static void *bot_ctx;
+
+static bool bot_next(int core, int *task) {
+    uint32_t save = spin_lock_blocking(bot_lock);
+    auto &own = bot_range[core], &other = bot_range[core ^ 1];
+    if (own.begin == own.end && other.begin < other.end) {
+        own.begin = other.begin + (other.end - other.begin) / 2;
+        own.end = other.end;
+        other.end = own.begin;
+    }
+    bool ok = own.begin < own.end;
+    if (ok)
+        *task = (int)own.begin++;
+    spin_unlock(bot_lock, save);
+    return ok;
 }
 
-static void on_piece_locked() {
-    was_holded_this_turn = false;
-    lock_piece(cur);
-    int cl = clear_lines();
-    if (cl) {
-        lines_cleared += cl;
-        static const int pts[5] = {0,40,100,300,1200};
-        score += pts[cl] * level;
-        level = 1 + lines_cleared / 10;
+static void bot_drain(int core) {
+    int task;
+    while (bot_next(core, &task))
+        bot_fn(bot_ctx, task, core);
+}
+
+static void core1_bot() {
+    while (true) {
+        multicore_fifo_pop_blocking();
+        bot_drain(1);
+        multicore_fifo_push_blocking(0);
     }
-    new_piece_from_queue();
-    was_grounded = false;
 }
 
-static void tick_fall() {
-    Piece t = cur; t.y++;
-    if (can_place(t)) {
-        cur = t;
-        was_grounded = false;
-        score++;
-    } else {
-        if (!was_grounded) {
-            was_grounded = true;
-            grounded_time = get_absolute_time();
-        } else {
-            if (absolute_time_diff_us(grounded_time, get_absolute_time()) >= (int64_t)LOCK_DELAY_MS*1000) {
-                on_piece_locked();
-            }
+static void bot_run(void *, int count, TetrisBotTask fn, void *ctx) {
+    bot_fn = fn;
+    bot_ctx = ctx;
+    bot_range[0] = {0, (uint32_t)count / 2};
+    bot_range[1] = {(uint32_t)count / 2, (uint32_t)count};
+    multicore_fifo_push_blocking(0);
+    bot_drain(0);
+    multicore_fifo_pop_blocking();
+}
+#endif
+
+static void autoplay(uint64_t now) {
+    static uint32_t seen = UINT32_MAX;
+    static uint64_t since, think_us, worst_us, evaluated, tt_probes, tt_hits;
+    static uint32_t plans, cut;
+    if (game.paused)
+        return;
+    if (game.pieces != seen) {
+        seen = game.pieces;
+        since = now;
+    }
+    if (now - since < (uint64_t)AUTOPLAY_PIECE_MS * 1000)
+        return;
+
+    // done before the piece would lock by itself
+    bot.deadline_us = tetris_bot_deadline_us(&game);
+    uint64_t t0 = time_us_64();
+    TetrisPlan plan;
+    bool ok = tetris_bot_plan(&bot, &game, &plan);
+    uint64_t us = time_us_64() - t0;
+    if (ok)
+        tetris_bot_play(&game, &plan);
+    else
+        tetris_game_hard_drop(&game);
+
+    think_us += us;
+    worst_us = (us > worst_us) ? us : worst_us;
+    if (++plans == AUTOPLAY_REPORT) {
+        uint64_t n = bot.evaluated - evaluated;
+        uint64_t probes = bot.tt_probes - tt_probes, hits = bot.tt_hits - tt_hits;
+        printf("bot: %u placements/s, %u us per piece, %u us worst, %u cut short, %u%% table hits, %u lines\n",
+               (unsigned)(think_us ? n * 1000000 / think_us : 0), (unsigned)(think_us / plans),
+               (unsigned)worst_us, (unsigned)(bot.cut - cut), (unsigned)(probes ? hits * 100 / probes : 0),
+               (unsigned)game.lines);
+        cut = bot.cut;
+        tt_probes = bot.tt_probes;
+        tt_hits = bot.tt_hits;
+        evaluated = bot.evaluated;
+        think_us = worst_us = 0;
+        plans = 0;
+    }
+}
+#endif
+
+#if TETRIS_DUAL_CORE
+// logic tick on core0: DAS/ARR, soft drop and input sampling advance at this
+// rate whatever the display manages
+static const int LOGIC_TICK_US = 4000;
+
+// Triple buffer between the cores: core0 fills snap_slots[snap_back] and
+// swaps it with snap_ready; core1 takes snap_ready into snap_front when it is
+// newer than what it drew last. Only the index swaps hold the spin lock, so
+// neither core ever waits for the other's work.
+static GameSnapshot snap_slots[3];
+static uint8_t snap_back = 0, snap_ready = 1, snap_front = 2;
+static bool snap_fresh = false;
+static spin_lock_t *snap_lock;
+
+static void snapshot_publish() {
+    uint32_t save = spin_lock_blocking(snap_lock);
+    uint8_t t = snap_back; snap_back = snap_ready; snap_ready = t;
+    snap_fresh = true;
+    spin_unlock(snap_lock, save);
+    __sev();
+}
+
+static const GameSnapshot &snapshot_acquire() {
+    while (true) {
+        uint32_t save = spin_lock_blocking(snap_lock);
+        if (snap_fresh) {
+            uint8_t t = snap_front; snap_front = snap_ready; snap_ready = t;
+            snap_fresh = false;
+            spin_unlock(snap_lock, save);
+            return snap_slots[snap_front];
         }
+        spin_unlock(snap_lock, save);
+        __wfe();
     }
 }
 
-static void reset_lock_if_grounded_changed(bool moved_or_rotated) {
-    if (moved_or_rotated && grounded(cur)) {
-        grounded_time = get_absolute_time();
-        was_grounded = true;
+// core1 owns the display: init here so the DMA interrupt is taken on this core too
+static void core1_main() {
+    ST7735_Init();
+    ST7735_FillScreen(ST7735_BLACK);
+    while (true) {
+        const GameSnapshot &s = snapshot_acquire();
+        update_fps();
+        present_frame(s);
     }
 }
+#endif
 
 int main() {
     // set_sys_clock_khz(100000, true);
-    holded.t = -1;
     stdio_init_all();
 
+#if TETRIS_DUAL_CORE
+    snap_lock = spin_lock_instance(spin_lock_claim_unused(true));
+#else
     ST7735_Init();
     ST7735_FillScreen(ST7735_BLACK);
+#endif
+    btn_init(PIN_LEFT);
+    btn_init(PIN_RIGHT);
     btn_init(PIN_ROT);
     btn_init(PIN_ROT_CCW);
     btn_init(PIN_SDROP);
     btn_init(PIN_HDROP);
     btn_init(PIN_PAUSE);
     btn_init(PIN_HOLD);
-    
-    ButtonHandler btn_L(PIN_LEFT, move_left);
-    ButtonHandler btn_R(PIN_RIGHT, move_right);
 
-    rng_state ^= (uint32_t)time_us_64();
-
-    memset(board, 0, sizeof(board));
-    bag.clear(); next_queue.clear();
-    ensure_next_queue(7);
-    new_piece_from_queue();
-
-    last_fall = get_absolute_time();
-    last_softdrop = get_absolute_time();
+    tetris_game_init(&game, 0x12345678 ^ (uint32_t)time_us_64(), time_us_64());
+#if TETRIS_PC_HINT
+    tetris_pc_init(&pc);
+    pc.clock_us = time_us_64;
+    tetris_tt_init(&pc_memo, pc_memo_buckets, sizeof(pc_memo_buckets));
+    tetris_pc_set_memo(&pc, &pc_memo);
+#endif
+#if TETRIS_AUTOPLAY
+    tetris_bot_init(&bot, TETRIS_AUTOPLAY_BEAM, TETRIS_AUTOPLAY_DEPTH);
+    bot.clock_us = time_us_64;
+#if TETRIS_AUTOPLAY_TT_KB
+    tetris_tt_init(&bot_tt, bot_tt_buckets, sizeof(bot_tt_buckets));
+    tetris_bot_set_tt(&bot, &bot_tt);
+#endif
+#if !TETRIS_DUAL_CORE
+    bot_lock = spin_lock_instance(spin_lock_claim_unused(true));
+    tetris_bot_set_workers(&bot, 2, bot_run, NULL);
+    multicore_launch_core1(core1_bot);
+#endif
+#endif
+
+#if TETRIS_DUAL_CORE
+    multicore_launch_core1(core1_main);
+    absolute_time_t next_tick = get_absolute_time();
+#else
+    static GameSnapshot frame_snap;
+#endif
 
     while (true) {
-        ST7735_FillScreen(ST7735_BLACK);
-
-        char level_string[20];
-        snprintf(level_string, sizeof(level_string), "%d", level);
-        
-        char fps_string[20];
-        snprintf(fps_string, sizeof(fps_string), "%d", fps_value);
-
-        ST7735_DrawString(100, 45, level_string, Font_11x18, ST7735_WHITE);
-        ST7735_DrawString(93, 68, fps_string, Font_11x18, ST7735_GREEN);
-
+#if !TETRIS_DUAL_CORE
         update_fps();
-        static bool prev_pause = false;
-        bool p_pause = btn_down(PIN_PAUSE);
-        if (p_pause && !prev_pause) paused = !paused;
-        prev_pause = p_pause;
-
-        if (!paused) {
-            btn_R.update();
-            btn_L.update();
-            static bool prev_rot = false;
-
-            bool rot = btn_down(PIN_ROT);
-            bool rot_ccw = btn_down(PIN_ROT_CCW);
-            if ((rot_ccw | rot) && !prev_rot) {
-                Piece before = cur;
-                int dir;
-                if (rot)dir = +1;
-                else dir = -1;
-                if (try_rotate_srs(cur, dir)) {
-                    reset_lock_if_grounded_changed(true);
-                } else {
-                    cur = before;
-                }
-            }
-
-            if (rot) prev_rot = rot;
-            else prev_rot = rot_ccw;
-
-            bool press_hold = btn_down(PIN_HOLD);
-            
-            if (press_hold && !was_holded_this_turn) {
-                was_holded_this_turn = true;
-
-                if (holded.t == -1) {
-                    holded = cur;
-
-                    new_piece_from_queue();
-
-                    cur.x = (COLS/2) - 2;
-                    cur.y = 0;
-                    cur.r = 0;
-                }
-                else {
-                    Piece swap = cur;
-                    cur = holded;
-                    cur.x = (COLS/2) - 2;
-                    cur.y = 0;
-                    cur.r = 0;
-                    holded = swap;
-                    }
-            }
-
-            bool sdrop = btn_down(PIN_SDROP);
-            if (sdrop) {
-                if (absolute_time_diff_us(last_softdrop, get_absolute_time()) >= (int64_t)SOFT_DROP_MS*10) {
-                    last_softdrop = get_absolute_time();
-                    Piece t = cur; t.y++;
-                    if (can_place(t)) {
-                        cur = t;
-                        was_grounded = false;
-                        score += 1;
-                    } else {
-                        if (!was_grounded) {
-                            was_grounded = true;
-                            grounded_time = get_absolute_time();
-                        } //else if (absolute_time_diff_us(grounded_time, get_absolute_time()) >= (int64_t)LOCK_DELAY_MS*10) {
-                        //     on_piece_locked();
-                        // }
-                    }
-                }
-            }
-
-            static bool prev_hard = false;
-            bool hdrop = btn_down(PIN_HDROP);
-            if (hdrop && !prev_hard) {
-                Piece g = ghost_of(cur);
-                int dy = g.y - cur.y;
-                if (dy > 0) score += 2*dy;
-                cur = g;
-                on_piece_locked();
-            }
-            prev_hard = hdrop;
-
-            int fall_ms = gravity_interval_ms();
-            if (absolute_time_diff_us(last_fall, get_absolute_time()) >= (int64_t)fall_ms * 1000) {
-                last_fall = get_absolute_time();
-                tick_fall();
-            }
-        }
-        
+#endif
+#if TETRIS_AUTOPLAY
+        autoplay(time_us_64());
+#endif
+        tetris_game_step(&game, read_buttons(), time_us_64());
+#if TETRIS_PC_HINT
+        pc_hint(time_us_64());
+#endif
+
         // Render
-        // ST7735_DrawImage(0, 0, 160, 128, cat_farmer);
-        draw_field_outline();
-        draw_board();
-        draw_ghost(cur);
-        draw_piece(cur);
-        draw_holded(holded);
-        draw_queue();
-
-        if (paused) { //pause case
-            ST7735_DrawRectFill(80-10, 64-16, 5, 20, ST7735_BLACK);
-            ST7735_DrawRectFill(80, 64-16, 5, 20, ST7735_BLACK);
-
-            ST7735_DrawRect(79-10, 63-16, 7, 22, ST7735_WHITE);
-            ST7735_DrawRect(79, 63-16, 7, 22, ST7735_WHITE);
-        }
-        ST7735_Update();
+#if TETRIS_DUAL_CORE
+        take_snapshot(snap_slots[snap_back]);
+        snapshot_publish();
+        next_tick = delayed_by_us(next_tick, LOGIC_TICK_US);
+        sleep_until(next_tick);
+#else
+        take_snapshot(frame_snap);
+        present_frame(frame_snap);
+#endif
 
     }
 
     return 0;
 }
-